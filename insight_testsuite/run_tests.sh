@@ -6,7 +6,12 @@ declare -r color_green="${color_start}0;32m"
 declare -r color_blue="${color_start}0;34m"
 declare -r color_norm="${color_start}0m"
 
-GRADER_ROOT=$(dirname ${BASH_SOURCE})
+# usage: run_tests.sh [test_folder...] (every folder of tests by default)
+# A test folder holding its own run.sh runs it instead of the project's, with every file of its
+# paymo_input; such tests run the programs built in ${PAYMO_BIN} (ctest sets it to the build
+# directory). Every file of a test's paymo_output is compared, not only the three outputs.
+
+GRADER_ROOT=$(cd $(dirname ${BASH_SOURCE}) && pwd)
 
 PROJECT_PATH=${GRADER_ROOT}/..
 
@@ -37,7 +42,7 @@ function check_project_struct {
 
 # setup testing output folder
 function setup_testing_input_output {
-  TEST_OUTPUT_PATH=${GRADER_ROOT}/temp
+  TEST_OUTPUT_PATH=${GRADER_ROOT}/temp/${test_folder}
   if [ -d ${TEST_OUTPUT_PATH} ]; then
     rm -rf ${TEST_OUTPUT_PATH}
   fi
@@ -51,65 +56,49 @@ function setup_testing_input_output {
 
   rm -r ${TEST_OUTPUT_PATH}/paymo_input/*
   rm -r ${TEST_OUTPUT_PATH}/paymo_output/*
-  cp -r ${GRADER_ROOT}/tests/${test_folder}/paymo_input/batch_payment.txt ${TEST_OUTPUT_PATH}/paymo_input/batch_payment.txt
-  cp -r ${GRADER_ROOT}/tests/${test_folder}/paymo_input/stream_payment.txt ${TEST_OUTPUT_PATH}/paymo_input/stream_payment.txt
+  cp -r ${GRADER_ROOT}/tests/${test_folder}/paymo_input/* ${TEST_OUTPUT_PATH}/paymo_input/
+  if [[ -f ${GRADER_ROOT}/tests/${test_folder}/run.sh ]]; then
+    cp ${GRADER_ROOT}/tests/${test_folder}/run.sh ${TEST_OUTPUT_PATH}/run.sh
+  fi
 }
 
 function compare_outputs {
-  PROJECT_ANSWER_PATH1=${GRADER_ROOT}/temp/paymo_output/output1.txt
-  PROJECT_ANSWER_PATH2=${GRADER_ROOT}/temp/paymo_output/output2.txt
-  PROJECT_ANSWER_PATH3=${GRADER_ROOT}/temp/paymo_output/output3.txt
-  TEST_ANSWER_PATH1=${GRADER_ROOT}/tests/${test_folder}/paymo_output/output1.txt
-  TEST_ANSWER_PATH2=${GRADER_ROOT}/tests/${test_folder}/paymo_output/output2.txt
-  TEST_ANSWER_PATH3=${GRADER_ROOT}/tests/${test_folder}/paymo_output/output3.txt
-
-  DIFF_RESULT1=$(diff -bB ${PROJECT_ANSWER_PATH1} ${TEST_ANSWER_PATH1} | wc -l)
-  if [ "${DIFF_RESULT1}" -eq "0" ] && [ -f ${PROJECT_ANSWER_PATH1} ]; then
-    echo -e "[${color_green}PASS${color_norm}]: ${test_folder} (output1.txt)"
-    PASS_CNT=$(($PASS_CNT+1))
-  else
-    echo -e "[${color_red}FAIL${color_norm}]: ${test_folder} (output1.txt)"
-    diff ${PROJECT_ANSWER_PATH1} ${TEST_ANSWER_PATH1}
-  fi
-
-  DIFF_RESULT2=$(diff -bB ${PROJECT_ANSWER_PATH2} ${TEST_ANSWER_PATH2} | wc -l)
-  if [ "${DIFF_RESULT2}" -eq "0" ] && [ -f ${PROJECT_ANSWER_PATH2} ]; then
-    echo -e "[${color_green}PASS${color_norm}]: ${test_folder} (output2.txt)"
-    PASS_CNT=$(($PASS_CNT+1))
-  else
-    echo -e "[${color_red}FAIL${color_norm}]: ${test_folder} (output2.txt)"
-    diff ${PROJECT_ANSWER_PATH2} ${TEST_ANSWER_PATH2}
-  fi
-
-  DIFF_RESULT3=$(diff -bB ${PROJECT_ANSWER_PATH3} ${TEST_ANSWER_PATH3} | wc -l)
-  if [ "${DIFF_RESULT3}" -eq "0" ] && [ -f ${PROJECT_ANSWER_PATH3} ]; then
-    echo -e "[${color_green}PASS${color_norm}]: ${test_folder} (output3.txt)"
-    PASS_CNT=$(($PASS_CNT+1))
-  else
-    echo -e "[${color_red}FAIL${color_norm}]: ${test_folder} (output3.txt)"
-    diff ${PROJECT_ANSWER_PATH3} ${TEST_ANSWER_PATH3}
-  fi
+  for TEST_ANSWER_PATH in ${GRADER_ROOT}/tests/${test_folder}/paymo_output/*; do
+    OUTPUT_NAME=$(basename ${TEST_ANSWER_PATH})
+    PROJECT_ANSWER_PATH=${TEST_OUTPUT_PATH}/paymo_output/${OUTPUT_NAME}
+
+    DIFF_RESULT=$(diff -bB ${PROJECT_ANSWER_PATH} ${TEST_ANSWER_PATH} | wc -l)
+    if [ "${DIFF_RESULT}" -eq "0" ] && [ -f ${PROJECT_ANSWER_PATH} ]; then
+      echo -e "[${color_green}PASS${color_norm}]: ${test_folder} (${OUTPUT_NAME})"
+      PASS_CNT=$(($PASS_CNT+1))
+    else
+      echo -e "[${color_red}FAIL${color_norm}]: ${test_folder} (${OUTPUT_NAME})"
+      diff ${PROJECT_ANSWER_PATH} ${TEST_ANSWER_PATH}
+    fi
+  done
 }
 
 function run_all_tests {
-  TEST_FOLDERS=$(ls ${GRADER_ROOT}/tests)
-  NUM_TESTS=$(($(echo $(echo ${TEST_FOLDERS} | wc -w)) * 3))
+  TEST_FOLDERS=${@:-$(ls ${GRADER_ROOT}/tests)}
+  NUM_TESTS=0
   PASS_CNT=0
 
   # Loop through all tests
   for test_folder in ${TEST_FOLDERS}; do
+    NUM_TESTS=$(($NUM_TESTS+$(ls ${GRADER_ROOT}/tests/${test_folder}/paymo_output | wc -l)))
 
     setup_testing_input_output
 
-    cd ${GRADER_ROOT}/temp
+    pushd ${TEST_OUTPUT_PATH} > /dev/null
     bash run.sh 2>&1
-    cd ../
+    popd > /dev/null
 
     compare_outputs
   done
 
   echo "[$(date)] ${PASS_CNT} of ${NUM_TESTS} tests passed" >> ${GRADER_ROOT}/results.txt
+  [ ${PASS_CNT} -eq ${NUM_TESTS} ]
 }
 
 check_project_struct
-run_all_tests
+run_all_tests "$@"
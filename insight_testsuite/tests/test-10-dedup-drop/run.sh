@@ -0,0 +1,5 @@
+#!/usr/bin/env bash
+
+# the retry of the first payment and of the last one are dropped, the payment with another amount is not;
+# the first payment replayed ten minutes later is outside the 60 seconds window and is scored again
+${PAYMO_BIN}/fraud-alert-bfs --dedup-window=60 --dedup=drop ./paymo_input/batch_payment.txt ./paymo_input/stream_payment.txt ./paymo_output/output1.txt ./paymo_output/output2.txt ./paymo_output/output3.txt
@@ -0,0 +1,5 @@
+#!/usr/bin/env bash
+
+# the stream is split over three feeds, every second has one payment in each feed in a varying feed order;
+# the merge releases them by timestamp, ties in feed order, and the output is that of the merged stream
+${PAYMO_BIN}/fraud-alert-bfs ./paymo_input/batch_payment.txt ./paymo_input/stream_feed1.txt,./paymo_input/stream_feed2.txt,./paymo_input/stream_feed3.txt ./paymo_output/output1.txt ./paymo_output/output2.txt ./paymo_output/output3.txt
@@ -0,0 +1,6 @@
+#!/usr/bin/env bash
+
+# 1 -> 3 arrives after 1 -> 4 but within the lateness: it is scored first and puts 4 at the 2nd degree of 1;
+# 2 -> 4 at 00:00:12 arrives behind the watermark (00:00:15): it is logged and not scored, so its edge
+# is missing when 2 -> 4 is paid again
+${PAYMO_BIN}/fraud-alert-bfs --lateness=5 --late-events=./paymo_output/late_events.txt ./paymo_input/batch_payment.txt ./paymo_input/stream_payment.txt ./paymo_output/output1.txt ./paymo_output/output2.txt ./paymo_output/output3.txt
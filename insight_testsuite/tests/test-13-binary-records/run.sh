@@ -0,0 +1,8 @@
+#!/usr/bin/env bash
+
+# both files are scored from binary records, the outputs are those of the CSV files;
+# the stream converted back to CSV is the original file
+${PAYMO_BIN}/paymo-convert ./paymo_input/batch_payment.txt ./paymo_input/batch_payment.bin
+${PAYMO_BIN}/paymo-convert ./paymo_input/stream_payment.txt ./paymo_input/stream_payment.bin
+${PAYMO_BIN}/fraud-alert-bfs ./paymo_input/batch_payment.bin ./paymo_input/stream_payment.bin ./paymo_output/output1.txt ./paymo_output/output2.txt ./paymo_output/output3.txt
+${PAYMO_BIN}/paymo-convert --to-csv ./paymo_input/stream_payment.bin ./paymo_output/stream_payment.txt
@@ -0,0 +1,9 @@
+#!/usr/bin/env bash
+
+# a verdict with its degree per payment: alerts, a marked duplicate, a payment to oneself, a malformed line,
+# a payment beyond the network and one whose search runs out of budget; the binary file is dumped as text
+${PAYMO_BIN}/fraud-alert-bfs --dedup-window=60 --quarantine=./paymo_output/quarantine.txt --search-budget=2 --verdicts=./verdicts.bin --verdict-degrees=yes ./paymo_input/batch_payment.txt ./paymo_input/stream_payment.txt ./paymo_output/output1.txt ./paymo_output/output2.txt ./paymo_output/output3.txt
+# magic, version and record size, then flags and degree per record
+od -An -v -c -N8 ./verdicts.bin > ./paymo_output/verdicts.txt
+od -An -v -tu4 -j8 -N8 ./verdicts.bin >> ./paymo_output/verdicts.txt
+od -An -v -tu1 -w2 -j16 ./verdicts.bin >> ./paymo_output/verdicts.txt
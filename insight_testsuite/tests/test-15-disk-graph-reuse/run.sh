@@ -0,0 +1,6 @@
+#!/usr/bin/env bash
+
+# the batch network is sorted into a CSR file and searched from it, then a second run maps the same file
+# without reading the batch (its argument names no file): both give the outputs of the in-memory network
+${PAYMO_BIN}/fraud-alert-bfs --disk-graph=./network.csr ./paymo_input/batch_payment.txt ./paymo_input/stream_payment.txt ./paymo_output/output1.txt ./paymo_output/output2.txt ./paymo_output/output3.txt
+${PAYMO_BIN}/fraud-alert-bfs --disk-graph=./network.csr --disk-graph-reuse=yes ./paymo_input/no_batch.txt ./paymo_input/stream_payment.txt ./paymo_output/reused1.txt ./paymo_output/reused2.txt ./paymo_output/reused3.txt
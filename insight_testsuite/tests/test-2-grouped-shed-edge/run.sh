@@ -0,0 +1,6 @@
+#!/usr/bin/env bash
+
+# the payer 1 is grouped (two payments over 100 in the window), its traversal finds 4 at the 4th degree;
+# the shed payment 2 -> 4 (below the priority amount, --slo=0 makes every payment overdue) then inserts
+# the edge that puts 4 at the 2nd degree: the grouped answer must not be used
+${PAYMO_BIN}/fraud-alert-bfs --service-queue=16 --slo=0 --overload=priority --group-window=4 ./paymo_input/batch_payment.txt ./paymo_input/stream_payment.txt ./paymo_output/output1.txt ./paymo_output/output2.txt ./paymo_output/output3.txt
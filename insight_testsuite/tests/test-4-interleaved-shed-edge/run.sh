@@ -0,0 +1,6 @@
+#!/usr/bin/env bash
+
+# 1 -> 4 is searched with the window, 4 is beyond the 4th degree of 1 at its start; the shed payment
+# 2 -> 5 (below the priority amount, --slo=0 makes every payment overdue) then inserts the edge that
+# puts 4 at the 3rd degree: the interleaved answer must not be used
+${PAYMO_BIN}/fraud-alert-bfs --service-queue=16 --slo=0 --overload=priority --interleave=4 ./paymo_input/batch_payment.txt ./paymo_input/stream_payment.txt ./paymo_output/output1.txt ./paymo_output/output2.txt ./paymo_output/output3.txt
@@ -0,0 +1,5 @@
+#!/usr/bin/env bash
+
+# bursts of payments by payer, a third of them shed under overload (--slo=0 makes every payment overdue):
+# the interleaved answers must match the plain search (paymo_output holds the outputs without --interleave)
+${PAYMO_BIN}/fraud-alert-bfs --service-queue=64 --slo=0 --overload=priority --interleave=31 ./paymo_input/batch_payment.txt ./paymo_input/stream_payment.txt ./paymo_output/output1.txt ./paymo_output/output2.txt ./paymo_output/output3.txt
@@ -0,0 +1,9 @@
+#!/usr/bin/env bash
+
+# service mode driven by the load generator: the stream is replayed into the scorer's stream FIFO and
+# the first output is read back from its FIFO; --slo=0 makes every payment overdue, so under
+# --overload=priority the payments from 100 up are scored in full, the others from the cheap signals
+mkfifo ./stream.fifo ./output1.fifo
+${PAYMO_BIN}/fraud-alert-bfs --service-queue=16 --slo=0 --overload=priority ./paymo_input/batch_payment.txt ./stream.fifo ./output1.fifo ./paymo_output/output2.txt ./paymo_output/output3.txt > ./scorer.log &
+${PAYMO_BIN}/paymo-loadgen --rate=2000 --record=./paymo_output/output1.txt ./paymo_input/stream_payment.txt ./stream.fifo ./output1.fifo > ./loadgen.log
+wait
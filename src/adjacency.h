@@ -0,0 +1,527 @@
+/*
+ * adjacency.h
+ *
+ * Payment network with an adaptive neighbour set per user. Degrees span six
+ * orders of magnitude, from one-off payers to merchants, and no single
+ * representation serves both ends: small neighbour sets live inline in the
+ * vertex record, mid sized ones in sorted vectors and the largest ones are
+ * indexed by a hashed set, or by a bitmap once they are dense. A vertex
+ * changes representation on its own as its degree grows.
+ *
+ * Under a memory budget the neighbour sets kept outside of the records can be
+ * paged out to a segment file once they turn cold, and are paged back in by
+ * the first access that needs them.
+ *
+ * The graph models the parts of the boost graph interface used by the search
+ * kernels (num_vertices, out_degree, adjacent_vertices), so they work on it
+ * unchanged.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef ADJACENCY_H_
+#define ADJACENCY_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "hash.h"
+
+enum neighbour_kind {
+	inline_neighbours, // sorted, inside the vertex record
+	sorted_neighbours, // sorted vector
+	hashed_neighbours, // vector in insertion order, indexed by an open addressing set
+	bitmap_neighbours // vector in insertion order, indexed by a bitmap over all vertices
+};
+
+const unsigned inline_capacity = 6; // fills the 32 byte vertex record next to the degree
+const uint32_t max_sorted_degree = 512; // sorted insertion and binary search stay cheap below this
+const uint32_t no_neighbour = 0xFFFFFFFF;
+
+/* Every neighbour set can be walked as a contiguous array (inline or in the
+ * vector), so traversals never care about the representation. Large sets keep
+ * their vector in insertion order and answer membership through the index:
+ * the hashed set (load factor at most 1/2) costs 8 to 16 bytes per neighbour,
+ * the bitmap one bit per vertex of the network, and a set switches to the
+ * bitmap when that is smaller.
+ *
+ * Paging works on whole neighbour sets. A paged out set keeps its record (the
+ * degree and representation) but has its vectors freed and a null list, and
+ * its neighbours sit in the segment, an unlinked temporary file that only
+ * grows (a set paged out again is appended anew). Coldness follows the CLOCK
+ * algorithm: every access to a set sets its reference bit, and the hand pages
+ * out the sets whose bit is clear and clears the others as it passes. A page
+ * in mutates the graph behind const accessors, so while paging is enabled the
+ * graph must not be searched from several threads at once.
+ */
+class adaptive_graph {
+private:
+	struct vertex_record {
+		uint32_t degree;
+		union {
+			uint32_t neighbours[inline_capacity]; // degree <= inline_capacity
+			struct {
+				uint32_t set; // index in sets
+				uint32_t kind;
+				const uint32_t* list; // sets[set].list.data(), saves a dependent load per traversal
+			} external;
+		};
+	};
+
+	struct neighbour_set {
+		std::vector<uint32_t> list;
+		std::vector<uint32_t> table; // hashed_neighbours
+		std::vector<uint64_t> bits; // bitmap_neighbours
+		uint32_t vertex; // owner of the set
+		uint64_t offset; // position of the neighbours in the segment while paged out
+	};
+
+	static_assert(sizeof(vertex_record) == 32, "a vertex record should be half a cache line");
+
+	// page ins restore the list pointer of the record and the vectors of the set
+	mutable std::vector<vertex_record> records;
+	mutable std::vector<neighbour_set> sets;
+	std::size_t edge_count;
+
+	std::FILE* segment; // null while paging is disabled
+	uint64_t segment_size;
+	mutable std::vector<uint8_t> referenced; // CLOCK reference bit of every set
+	std::size_t hand;
+	mutable unsigned long page_ins;
+	unsigned long page_outs;
+
+	adaptive_graph(const adaptive_graph&);
+	adaptive_graph& operator=(const adaptive_graph&);
+
+	neighbour_kind kind(const vertex_record& r) const {
+		return r.degree <= inline_capacity ? inline_neighbours : (neighbour_kind) r.external.kind;
+	}
+
+	static bool table_contains(const std::vector<uint32_t>& table, uint32_t v) {
+		std::size_t mask = table.size() - 1;
+		for (std::size_t slot = mix64(v) & mask;; slot = (slot + 1) & mask) {
+			if (table[slot] == v)
+				return true;
+			if (table[slot] == no_neighbour)
+				return false;
+		}
+	}
+
+	static void table_insert(std::vector<uint32_t>& table, uint32_t v) {
+		std::size_t mask = table.size() - 1;
+		std::size_t slot = mix64(v) & mask;
+		while (table[slot] != no_neighbour)
+			slot = (slot + 1) & mask;
+		table[slot] = v;
+	}
+
+	static bool bitmap_contains(const std::vector<uint64_t>& bits, uint32_t v) {
+		return (v >> 6) < bits.size() && (bits[v >> 6] >> (v & 63) & 1);
+	}
+
+	// rebuilds the index of a large set, choosing between the hashed set and the bitmap
+	void reindex(neighbour_set& set, vertex_record& r) const {
+		std::size_t slots = 16; // load factor 1/4 after a rebuild, 1/2 before the next one
+		while (slots < 4 * set.list.size())
+			slots <<= 1;
+		if (records.size() <= slots * 32) { // the bitmap takes no more bytes than the table
+			r.external.kind = bitmap_neighbours;
+			std::vector<uint32_t>().swap(set.table);
+			set.bits.assign((records.size() + 63) / 64, 0);
+			for (std::size_t indx = 0; indx < set.list.size(); indx++)
+				set.bits[set.list[indx] >> 6] |= (uint64_t) 1 << (set.list[indx] & 63);
+		} else {
+			r.external.kind = hashed_neighbours;
+			set.table.assign(slots, no_neighbour);
+			for (std::size_t indx = 0; indx < set.list.size(); indx++)
+				table_insert(set.table, set.list[indx]);
+		}
+	}
+
+	// marks the neighbour set of r as used, paging it in first if it is out
+	void use(const vertex_record& r) const {
+		if (!segment || r.degree <= inline_capacity)
+			return;
+		if (!r.external.list)
+			page_in(r.external.set);
+		referenced[r.external.set] = 1;
+	}
+
+	void page_in(uint32_t indx) const {
+		neighbour_set& set = sets[indx];
+		vertex_record& r = records[set.vertex];
+		set.list.resize(r.degree);
+		std::size_t bytes = r.degree * sizeof(uint32_t), done = 0;
+		while (done < bytes) {
+			ssize_t got = pread(fileno(segment), (char*) &set.list[0] + done, bytes - done, set.offset + done);
+			if (got <= 0)
+				throw std::runtime_error("cannot read a neighbour set back from the spill segment");
+			done += got;
+		}
+		if (r.external.kind != sorted_neighbours)
+			reindex(set, r);
+		r.external.list = &set.list[0];
+		page_ins++;
+	}
+
+	// writes a set out to the end of the segment and frees it, returns the bytes freed
+	std::size_t page_out(uint32_t indx) {
+		neighbour_set& set = sets[indx];
+		vertex_record& r = records[set.vertex];
+		std::size_t bytes = r.degree * sizeof(uint32_t), done = 0;
+		while (done < bytes) {
+			ssize_t put = pwrite(fileno(segment), (const char*) &set.list[0] + done, bytes - done, segment_size + done);
+			if (put <= 0)
+				return 0; // the disk is full: the set stays in memory
+			done += put;
+		}
+		std::size_t freed = set.list.capacity() * sizeof(uint32_t) + set.table.capacity() * sizeof(uint32_t)
+				+ set.bits.capacity() * sizeof(uint64_t);
+		set.offset = segment_size;
+		segment_size += bytes;
+		std::vector<uint32_t>().swap(set.list);
+		std::vector<uint32_t>().swap(set.table);
+		std::vector<uint64_t>().swap(set.bits);
+		r.external.list = 0;
+		page_outs++;
+		return freed;
+	}
+
+	void insert(uint32_t u, uint32_t v) {
+		vertex_record& r = records[u];
+		use(r);
+		if (r.degree < inline_capacity) {
+			uint32_t* end = r.neighbours + r.degree;
+			uint32_t* at = std::upper_bound(r.neighbours, end, v);
+			std::copy_backward(at, end, end + 1);
+			*at = v;
+		} else if (r.degree == inline_capacity) {
+			// the inline array moves out to a sorted vector
+			sets.push_back(neighbour_set());
+			referenced.push_back(1);
+			neighbour_set& set = sets.back();
+			set.vertex = u;
+			set.list.assign(r.neighbours, r.neighbours + inline_capacity);
+			set.list.insert(std::upper_bound(set.list.begin(), set.list.end(), v), v);
+			r.external.set = sets.size() - 1;
+			r.external.kind = sorted_neighbours;
+			r.external.list = &set.list[0];
+		} else {
+			neighbour_set& set = sets[r.external.set];
+			switch (r.external.kind) {
+			case sorted_neighbours:
+				if (r.degree < max_sorted_degree) {
+					set.list.insert(std::upper_bound(set.list.begin(), set.list.end(), v), v);
+				} else {
+					set.list.push_back(v);
+					reindex(set, r);
+				}
+				break;
+			case hashed_neighbours:
+				set.list.push_back(v);
+				if (set.list.size() * 2 > set.table.size())
+					reindex(set, r);
+				else
+					table_insert(set.table, v);
+				break;
+			default:
+				set.list.push_back(v);
+				if ((v >> 6) >= set.bits.size())
+					set.bits.resize((records.size() + 63) / 64, 0);
+				set.bits[v >> 6] |= (uint64_t) 1 << (v & 63);
+			}
+			r.external.list = &set.list[0];
+		}
+		r.degree++;
+	}
+
+	// merges the sorted new neighbours added into the set of u
+	void merge(uint32_t u, const std::vector<uint32_t>& added) {
+		vertex_record& r = records[u];
+		use(r);
+		uint32_t degree = r.degree + added.size();
+		if (degree <= inline_capacity) {
+			uint32_t merged[inline_capacity];
+			std::merge(r.neighbours, r.neighbours + r.degree, added.begin(), added.end(), merged);
+			std::copy(merged, merged + degree, r.neighbours);
+			r.degree = degree;
+			return;
+		}
+		if (r.degree <= inline_capacity) {
+			// the inline array moves out to a sorted vector
+			sets.push_back(neighbour_set());
+			referenced.push_back(1);
+			neighbour_set& set = sets.back();
+			set.vertex = u;
+			set.list.assign(r.neighbours, r.neighbours + r.degree);
+			r.external.set = sets.size() - 1;
+			r.external.kind = sorted_neighbours;
+		}
+		neighbour_set& set = sets[r.external.set];
+		std::size_t old_size = set.list.size();
+		set.list.insert(set.list.end(), added.begin(), added.end());
+		switch (r.external.kind) {
+		case sorted_neighbours:
+			if (degree <= max_sorted_degree)
+				std::inplace_merge(set.list.begin(), set.list.begin() + old_size, set.list.end());
+			else
+				reindex(set, r);
+			break;
+		case hashed_neighbours:
+			if (set.list.size() * 2 > set.table.size())
+				reindex(set, r);
+			else
+				for (std::size_t indx = 0; indx < added.size(); indx++)
+					table_insert(set.table, added[indx]);
+			break;
+		default:
+			if ((added.back() >> 6) >= set.bits.size())
+				set.bits.resize((records.size() + 63) / 64, 0);
+			for (std::size_t indx = 0; indx < added.size(); indx++)
+				set.bits[added[indx] >> 6] |= (uint64_t) 1 << (added[indx] & 63);
+		}
+		r.external.list = &set.list[0];
+		r.degree = degree;
+	}
+
+	// v in the neighbour set of u, with the kernel of u's representation
+	bool contains(const vertex_record& r, uint32_t v) const {
+		switch (kind(r)) {
+		case inline_neighbours:
+			for (unsigned indx = 0; indx < r.degree; indx++)
+				if (r.neighbours[indx] == v)
+					return true;
+			return false;
+		case sorted_neighbours:
+			return std::binary_search(sets[r.external.set].list.begin(), sets[r.external.set].list.end(), v);
+		case hashed_neighbours:
+			return table_contains(sets[r.external.set].table, v);
+		default:
+			return bitmap_contains(sets[r.external.set].bits, v);
+		}
+	}
+
+	// cost rank of a membership test: the indexed sets answer in constant time
+	int probe_cost(const vertex_record& r) const {
+		switch (kind(r)) {
+		case bitmap_neighbours: return 0;
+		case hashed_neighbours: return 1;
+		default: return 2;
+		}
+	}
+
+	// merge of two sorted arrays, galloping through the longer one when they are unbalanced
+	static bool sorted_intersect(const uint32_t* a, const uint32_t* a_end, const uint32_t* b, const uint32_t* b_end) {
+		if (a_end - a > b_end - b) {
+			std::swap(a, b);
+			std::swap(a_end, b_end);
+		}
+		if ((b_end - b) / 16 > a_end - a) {
+			for (; a != a_end; ++a) {
+				b = std::lower_bound(b, b_end, *a);
+				if (b == b_end)
+					return false;
+				if (*b == *a)
+					return true;
+			}
+			return false;
+		}
+		while (a != a_end && b != b_end) {
+			if (*a < *b)
+				++a;
+			else if (*b < *a)
+				++b;
+			else
+				return true;
+		}
+		return false;
+	}
+public:
+	typedef std::size_t vertex_descriptor;
+	typedef const uint32_t* adjacency_iterator;
+
+	adaptive_graph() : edge_count(0), segment(0), segment_size(0), hand(0), page_ins(0), page_outs(0) {}
+
+	~adaptive_graph() {
+		if (segment)
+			std::fclose(segment);
+	}
+
+	std::size_t add_vertex() {
+		vertex_record r;
+		r.degree = 0;
+		records.push_back(r);
+		return records.size() - 1;
+	}
+
+	// adds the undirected edge (u, v), the caller makes sure it is not there yet
+	// (a self-loop puts u in its own set once)
+	void add_edge(std::size_t u, std::size_t v) {
+		insert(u, v);
+		if (u != v)
+			insert(v, u);
+		edge_count++;
+	}
+
+	// adds a batch of undirected edges, none of them in the graph yet nor repeated: the new
+	// neighbours of every vertex are sorted and merged into its set at once, so a set is
+	// reindexed once per batch instead of once per growth step
+	void add_edges(const std::vector<std::pair<std::size_t, std::size_t> >& batch) {
+		std::vector<std::pair<uint32_t, uint32_t> > entries; // (vertex, new neighbour)
+		entries.reserve(2 * batch.size());
+		for (std::size_t indx = 0; indx < batch.size(); indx++) {
+			entries.push_back(std::make_pair(batch[indx].first, batch[indx].second));
+			if (batch[indx].first != batch[indx].second)
+				entries.push_back(std::make_pair(batch[indx].second, batch[indx].first));
+		}
+		std::sort(entries.begin(), entries.end());
+		std::vector<uint32_t> added;
+		for (std::size_t first = 0, last; first < entries.size(); first = last) {
+			added.clear();
+			for (last = first; last < entries.size() && entries[last].first == entries[first].first; last++)
+				added.push_back(entries[last].second);
+			merge(entries[first].first, added);
+		}
+		edge_count += batch.size();
+	}
+
+	// drops every edge and keeps the vertices (the edges were written out, see disk_graph.h)
+	void clear_edges() {
+		for (std::size_t v = 0; v < records.size(); v++)
+			records[v].degree = 0;
+		std::vector<neighbour_set>().swap(sets);
+		std::vector<uint8_t>().swap(referenced);
+		hand = 0;
+		edge_count = 0;
+	}
+
+	// membership tested on whichever endpoint has the cheapest kernel (the smaller
+	// set when both are sorted)
+	bool has_edge(std::size_t u, std::size_t v) const {
+		const vertex_record* a = &records[u];
+		const vertex_record* b = &records[v];
+		int cost_a = probe_cost(*a), cost_b = probe_cost(*b);
+		if (cost_b < cost_a || (cost_b == cost_a && b->degree < a->degree)) {
+			std::swap(a, b);
+			std::swap(u, v);
+		}
+		use(*a);
+		return contains(*a, v);
+	}
+
+	// whether u and v share a neighbour: two bitmaps are ANDed word by word, two sorted
+	// sets merged (or galloped), otherwise the smaller set is probed against the other
+	bool intersects(std::size_t u, std::size_t v) const {
+		const vertex_record& a = records[u];
+		const vertex_record& b = records[v];
+		use(a);
+		use(b);
+		neighbour_kind ka = kind(a), kb = kind(b);
+		if (ka == bitmap_neighbours && kb == bitmap_neighbours) {
+			const std::vector<uint64_t>& x = sets[a.external.set].bits;
+			const std::vector<uint64_t>& y = sets[b.external.set].bits;
+			for (std::size_t indx = 0, n = std::min(x.size(), y.size()); indx < n; indx++)
+				if (x[indx] & y[indx])
+					return true;
+			return false;
+		}
+		std::pair<adjacency_iterator, adjacency_iterator> na = neighbours(u), nb = neighbours(v);
+		if (ka <= sorted_neighbours && kb <= sorted_neighbours)
+			return sorted_intersect(na.first, na.second, nb.first, nb.second);
+		const vertex_record& probed = a.degree <= b.degree ? b : a;
+		std::pair<adjacency_iterator, adjacency_iterator> scanned = a.degree <= b.degree ? na : nb;
+		for (adjacency_iterator it = scanned.first; it != scanned.second; ++it)
+			if (contains(probed, *it))
+				return true;
+		return false;
+	}
+
+	std::pair<adjacency_iterator, adjacency_iterator> neighbours(std::size_t v) const {
+		const vertex_record& r = records[v];
+		if (r.degree <= inline_capacity)
+			return std::make_pair(r.neighbours, r.neighbours + r.degree);
+		use(r);
+		return std::make_pair(r.external.list, r.external.list + r.degree);
+	}
+
+	// cache hints for traversals: the vertex record, then (once the record is in cache)
+	// the first two lines of a neighbour list kept outside of it
+	void prefetch_record(std::size_t v) const { __builtin_prefetch(&records[v]); }
+	void prefetch_neighbours(std::size_t v) const {
+		const vertex_record& r = records[v];
+		if (r.degree > inline_capacity && r.external.list) {
+			__builtin_prefetch(r.external.list);
+			__builtin_prefetch(r.external.list + 16);
+		}
+	}
+
+	// starts paging to an unlinked temporary segment, false if it cannot be created
+	bool enable_paging() {
+		if (!segment)
+			segment = std::tmpfile();
+		return segment != 0;
+	}
+
+	// pages out cold neighbour sets until bytes were freed or every set is either hot or
+	// out already (the hand goes around twice at most), returns the bytes freed
+	std::size_t page_out_cold(std::size_t bytes) {
+		std::size_t freed = 0;
+		for (std::size_t steps = 0; segment && freed < bytes && steps < 2 * sets.size(); steps++) {
+			uint32_t indx = hand;
+			hand = (hand + 1) % sets.size();
+			if (!records[sets[indx].vertex].external.list)
+				continue;
+			if (referenced[indx])
+				referenced[indx] = 0;
+			else
+				freed += page_out(indx);
+		}
+		return freed;
+	}
+
+	unsigned long paged_in() const { return page_ins; }
+	unsigned long paged_out() const { return page_outs; }
+	uint64_t segment_bytes() const { return segment_size; }
+
+	neighbour_kind representation(std::size_t v) const { return kind(records[v]); }
+	std::size_t degree(std::size_t v) const { return records[v].degree; }
+	std::size_t vertex_count() const { return records.size(); }
+	std::size_t edges() const { return edge_count; }
+
+	std::size_t memory() const {
+		std::size_t bytes = records.capacity() * sizeof(vertex_record) + sets.capacity() * sizeof(neighbour_set)
+				+ referenced.capacity();
+		for (std::size_t indx = 0; indx < sets.size(); indx++)
+			bytes += sets[indx].list.capacity() * sizeof(uint32_t) + sets[indx].table.capacity() * sizeof(uint32_t)
+					+ sets[indx].bits.capacity() * sizeof(uint64_t);
+		return bytes;
+	}
+};
+
+// the subset of the boost graph interface used by the search kernels
+namespace boost {
+template <>
+struct graph_traits<adaptive_graph> {
+	typedef adaptive_graph::vertex_descriptor vertex_descriptor;
+	typedef adaptive_graph::adjacency_iterator adjacency_iterator;
+	typedef std::size_t vertices_size_type;
+	typedef std::size_t degree_size_type;
+};
+}
+
+inline std::size_t num_vertices(const adaptive_graph& g) { return g.vertex_count(); }
+inline std::size_t out_degree(std::size_t v, const adaptive_graph& g) { return g.degree(v); }
+inline std::pair<adaptive_graph::adjacency_iterator, adaptive_graph::adjacency_iterator>
+adjacent_vertices(std::size_t v, const adaptive_graph& g) { return g.neighbours(v); }
+inline void prefetch_vertex(std::size_t v, const adaptive_graph& g) { g.prefetch_record(v); }
+inline void prefetch_adjacency(std::size_t v, const adaptive_graph& g) { g.prefetch_neighbours(v); }
+
+#endif /* ADJACENCY_H_ */
@@ -0,0 +1,129 @@
+/*
+ * admission.h
+ *
+ * Admission control of the service mode. Payments are taken from the feeds
+ * by an ingest thread into a bounded queue, so a burst can never queue more
+ * than the queue capacity (the ingest thread, and through it the writers of
+ * the feeds, block instead). The scorer measures how long every payment
+ * waited, and the overload policy decides how a payment that waited beyond
+ * the latency objective is scored.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef ADMISSION_H_
+#define ADMISSION_H_
+
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <thread>
+#include <utility>
+
+#include "bounded_queue.h"
+#include "latency_histogram.h"
+#include "payment.h"
+
+// what happens to a payment that waited beyond the latency objective
+enum overload_policy {
+	overload_wait, // nothing: it is scored in full, however late
+	overload_shed, // it is scored from the cheap signals only
+	overload_reject, // it is not scored
+	overload_priority // it is scored in full from the priority amount up, from the cheap signals below
+};
+
+class overload_control {
+private:
+	overload_policy policy;
+	std::chrono::steady_clock::duration slo;
+	double priority_amount;
+public:
+	overload_control(overload_policy policy, unsigned long slo_microseconds, double priority_amount) :
+		policy(policy), slo(std::chrono::microseconds(slo_microseconds)), priority_amount(priority_amount) {}
+
+	scoring_mode decide(std::chrono::steady_clock::duration delay, double amount) const {
+		if (delay <= slo || policy == overload_wait)
+			return score_full;
+		if (policy == overload_reject)
+			return score_rejected;
+		if (policy == overload_priority && amount >= priority_amount)
+			return score_full;
+		return score_cheap;
+	}
+
+	std::chrono::steady_clock::duration objective() const { return slo; }
+};
+
+/* admission_stage is the last stage before the scorer. A payment is stamped
+ * when the ingest thread takes it from the upstream stages, its queue delay
+ * is measured when the scorer takes it, and its sojourn time when the scorer
+ * reports its verdict written (completed, in order).
+ */
+class admission_stage : public payment_source {
+private:
+	struct queued_payment {
+		payment_t payment;
+		std::chrono::steady_clock::time_point arrival;
+	};
+
+	payment_source& upstream;
+	bounded_queue<queued_payment> queue;
+	overload_control control;
+	std::thread ingest;
+	std::deque<std::chrono::steady_clock::time_point> pending; // arrivals of the payments handed out
+	latency_histogram delays;
+	latency_histogram sojourns;
+	unsigned long counts[3]; // by scoring mode
+
+	void run() {
+		queued_payment item;
+		while (upstream.next(item.payment)) {
+			item.arrival = std::chrono::steady_clock::now();
+			if (!queue.push(std::move(item)))
+				return;
+		}
+		queue.close();
+	}
+
+	admission_stage(const admission_stage&);
+	admission_stage& operator=(const admission_stage&);
+public:
+	admission_stage(payment_source& upstream, std::size_t capacity, const overload_control& control) :
+		upstream(upstream), queue(capacity), control(control) {
+		counts[score_full] = counts[score_cheap] = counts[score_rejected] = 0;
+		ingest = std::thread(&admission_stage::run, this);
+	}
+
+	~admission_stage() {
+		queue.close();
+		if (ingest.joinable())
+			ingest.join();
+	}
+
+	bool next(payment_t& payment) {
+		queued_payment item;
+		if (!queue.pop(item))
+			return false;
+		std::chrono::steady_clock::duration delay = std::chrono::steady_clock::now() - item.arrival;
+		delays.record(delay);
+		payment = std::move(item.payment);
+		payment.scoring = control.decide(delay, std::atof(payment.amount.c_str()));
+		counts[payment.scoring]++;
+		pending.push_back(item.arrival);
+		return true;
+	}
+
+	// the verdict of the oldest payment handed out and not completed yet was written
+	void completed() {
+		if (pending.empty())
+			return;
+		sojourns.record(std::chrono::steady_clock::now() - pending.front());
+		pending.pop_front();
+	}
+
+	const latency_histogram& queue_delays() const { return delays; }
+	const latency_histogram& sojourn_times() const { return sojourns; }
+	unsigned long scored(scoring_mode mode) const { return counts[mode]; }
+};
+
+#endif /* ADMISSION_H_ */
@@ -0,0 +1,225 @@
+/*
+ * ball_cache.h
+ *
+ * Distance balls of the most recent payers. Payers often send several
+ * payments in a burst, and each of them would start a new bounded search
+ * from the same vertex; instead the whole ball of radius 4 around a repeated
+ * payer is saved and the following payments are answered by a lookup in it.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef BALL_CACHE_H_
+#define BALL_CACHE_H_
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "bounded_bfs.h"
+#include "hash.h"
+
+const uint32_t no_ball_vertex = 0xFFFFFFFF;
+const std::size_t max_ball_vertices = 1 << 17; // larger balls are not worth keeping
+const unsigned recent_payers = 8; // a payer among the last ones gets its ball saved
+
+/* A saved ball maps every vertex within the radius to its distance from the
+ * source (open addressing, load factor at most 1/2). Adding an edge (a, b) can
+ * only shorten distances, and only when one endpoint lies strictly inside the
+ * ball, so the ball is patched instead of dropped: the closer endpoint pulls
+ * the other one in and the decrease is propagated breadth first up to the
+ * radius. Every scored payment adds the edge from its payer, so without the
+ * patch no ball would survive until the next payment of the burst.
+ */
+class ball_cache {
+private:
+	struct ball {
+		std::size_t source;
+		unsigned long last_used;
+		std::size_t count;
+		std::vector<uint32_t> keys;
+		std::vector<uint8_t> distances;
+	};
+
+	std::vector<ball> balls; // source == no_ball_vertex for a free slot
+	int radius;
+	unsigned long clock;
+	std::deque<std::size_t> recent;
+	std::deque<std::size_t> queue;
+	unsigned long hits, builds, patches, drops;
+
+	static std::size_t find_slot(const ball& b, uint32_t v) {
+		std::size_t mask = b.keys.size() - 1;
+		std::size_t slot = mix64(v) & mask;
+		while (b.keys[slot] != v && b.keys[slot] != no_ball_vertex)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	static int get(const ball& b, std::size_t v, int beyond) {
+		std::size_t slot = find_slot(b, v);
+		return b.keys[slot] == v ? b.distances[slot] : beyond;
+	}
+
+	static void put(ball& b, std::size_t v, int distance) {
+		if (2 * (b.count + 1) > b.keys.size()) {
+			std::vector<uint32_t> keys(2 * b.keys.size(), no_ball_vertex);
+			std::vector<uint8_t> distances(2 * b.keys.size(), 0);
+			keys.swap(b.keys);
+			distances.swap(b.distances);
+			b.count = 0;
+			for (std::size_t slot = 0; slot < keys.size(); slot++)
+				if (keys[slot] != no_ball_vertex)
+					put(b, keys[slot], distances[slot]);
+		}
+		std::size_t slot = find_slot(b, v);
+		if (b.keys[slot] == no_ball_vertex) {
+			b.keys[slot] = v;
+			b.count++;
+		}
+		b.distances[slot] = distance;
+	}
+
+	static void clear(ball& b) {
+		b.source = no_ball_vertex;
+		b.count = 0;
+		b.keys.assign(64, no_ball_vertex);
+		b.distances.assign(64, 0);
+	}
+
+	ball* find(std::size_t source) {
+		for (std::size_t indx = 0; indx < balls.size(); indx++)
+			if (balls[indx].source == source)
+				return &balls[indx];
+		return 0;
+	}
+
+	// records every vertex the exploration reaches, and stops expanding once the ball is too large
+	struct ball_recording {
+		ball& b;
+		bool& overflow;
+		bool operator()(std::size_t vertex, int distance) const {
+			if (b.count >= max_ball_vertices)
+				overflow = true;
+			else
+				put(b, vertex, distance);
+			return overflow;
+		}
+	};
+
+	// lowers the distance of v to d and propagates the decrease, false if the ball grew too large
+	template <typename Graph>
+	bool pull(ball& b, std::size_t v, int d, const Graph& g) {
+		put(b, v, d);
+		queue.assign(1, v);
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		while (!queue.empty()) {
+			std::size_t x = queue.front();
+			queue.pop_front();
+			int dy = get(b, x, radius + 1) + 1;
+			if (dy > radius)
+				continue;
+			for (boost::tie(vi, vi_end) = adjacent_vertices(x, g); vi != vi_end; ++vi) {
+				if (dy < get(b, *vi, radius + 1)) {
+					put(b, *vi, dy);
+					queue.push_back(*vi);
+				}
+			}
+			if (b.count > max_ball_vertices)
+				return false;
+		}
+		return true;
+	}
+public:
+	ball_cache(unsigned slots, int radius) : balls(std::max(1u, slots)), radius(radius), clock(0),
+		hits(0), builds(0), patches(0), drops(0) {
+		for (std::size_t indx = 0; indx < balls.size(); indx++) {
+			clear(balls[indx]);
+			balls[indx].last_used = 0;
+		}
+	}
+
+	// the distance between source and target (radius + 1 beyond it) if the ball of source is saved
+	bool lookup(std::size_t source, std::size_t target, int& distance) {
+		ball* b = find(source);
+		if (!b)
+			return false;
+		b->last_used = ++clock;
+		distance = get(*b, target, radius + 1);
+		hits++;
+		return true;
+	}
+
+	// registers a payment from source, true when the source paid recently (a burst)
+	bool repeated(std::size_t source) {
+		bool seen = std::find(recent.begin(), recent.end(), source) != recent.end();
+		recent.push_back(source);
+		if (recent.size() > recent_payers)
+			recent.pop_front();
+		return seen;
+	}
+
+	// explores and saves the ball of source in the least recently used slot, false if it is too large
+	template <typename Graph>
+	bool build(const Graph& g, bounded_bfs& search, std::size_t source) {
+		ball* b = &balls[0];
+		for (std::size_t indx = 1; indx < balls.size(); indx++)
+			if (balls[indx].last_used < b->last_used)
+				b = &balls[indx];
+		clear(*b);
+		bool overflow = false;
+		ball_recording recording = { *b, overflow };
+		put(*b, source, 0);
+		search.explore(g, source, radius, recording);
+		if (overflow) {
+			clear(*b);
+			drops++;
+			return false;
+		}
+		b->source = source;
+		b->last_used = ++clock;
+		builds++;
+		return true;
+	}
+
+	// patches the saved balls after the edge (a, b) was added to the graph
+	template <typename Graph>
+	void add_edge(std::size_t a, std::size_t b, const Graph& g) {
+		for (std::size_t indx = 0; indx < balls.size(); indx++) {
+			ball& saved = balls[indx];
+			if (saved.source == no_ball_vertex)
+				continue;
+			int da = get(saved, a, radius + 1), db = get(saved, b, radius + 1);
+			bool kept = true;
+			if (da + 1 < db && da < radius)
+				kept = pull(saved, b, da + 1, g);
+			else if (db + 1 < da && db < radius)
+				kept = pull(saved, a, db + 1, g);
+			else
+				continue;
+			patches++;
+			if (!kept) {
+				clear(saved);
+				drops++;
+			}
+		}
+	}
+
+	unsigned long lookups() const { return hits; }
+	unsigned long balls_built() const { return builds; }
+	unsigned long balls_patched() const { return patches; }
+	unsigned long balls_dropped() const { return drops; }
+
+	std::size_t memory() const {
+		std::size_t bytes = 0;
+		for (std::size_t indx = 0; indx < balls.size(); indx++)
+			bytes += balls[indx].keys.capacity() * sizeof(uint32_t) + balls[indx].distances.capacity();
+		return bytes;
+	}
+};
+
+#endif /* BALL_CACHE_H_ */
@@ -0,0 +1,166 @@
+/*
+ * batch_loader.h
+ *
+ * Parallel reader of batch payment files. The history may be partitioned
+ * into many files (a directory or a glob pattern of daily files): with at
+ * least as many files as threads every file is parsed by a pool task of its
+ * own, which also keeps several reads in flight on the storage. Fewer files
+ * are read one at a time, each in one go, cut into chunks at line boundaries
+ * and the chunks parsed by the pool. Every line goes through the same record
+ * parser as the sequential reader of payment.h, or through the strict one
+ * when a quarantine log is given (malformed lines are then left out and
+ * logged with their line numbers).
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef BATCH_LOADER_H_
+#define BATCH_LOADER_H_
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glob.h>
+#include <sys/stat.h>
+
+#include "payment.h"
+#include "quarantine.h"
+#include "thread_pool.h"
+
+const std::size_t chunks_per_thread = 4; // lets the pool even out chunks of uneven lines
+
+// a line refused by the strict reader of a chunk, logged once the line numbers are known
+struct refused_line {
+	std::size_t line; // within the chunk, from 0
+	record_fault fault;
+	std::string text;
+};
+
+// reads the records of a batch payment file (after its header line), false if it cannot be read
+inline bool read_batch_parallel(const std::string& path, data_t& data, thread_pool& pool,
+		quarantine_log* quarantine = 0) {
+	data.clear();
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file.is_open())
+		return false;
+	file.seekg(0, std::ios::end);
+	std::streamoff size = file.tellg();
+	if (size < 0)
+		return false;
+	std::string text(size, '\0');
+	file.seekg(0, std::ios::beg);
+	if (size > 0 && !file.read(&text[0], size))
+		return false;
+
+	// chunk boundaries fall right after a newline, the header line belongs to no chunk
+	std::string::size_type start = text.find('\n');
+	start = start == std::string::npos ? text.size() : start + 1;
+	std::size_t count = pool.size() * chunks_per_thread;
+	std::vector<std::size_t> bounds(1, start);
+	for (std::size_t indx = 1; indx < count; indx++) {
+		std::string::size_type at = start + (text.size() - start) * indx / count;
+		if (at <= bounds.back())
+			continue;
+		at = text.find('\n', at - 1); // a newline right before at already makes it a line start
+		if (at == std::string::npos)
+			break;
+		if (at + 1 > bounds.back() && at + 1 < text.size())
+			bounds.push_back(at + 1);
+	}
+	bounds.push_back(text.size());
+
+	std::vector<data_t> parts(bounds.size() - 1);
+	std::vector<std::size_t> lines(parts.size(), 0);
+	std::vector<std::vector<refused_line> > refused(parts.size());
+	pool.parallel_for(0, parts.size(), 1, [&](std::size_t first, std::size_t last, unsigned worker) {
+		std::string line;
+		payment_t record;
+		for (std::size_t chunk = first; chunk < last; chunk++) {
+			for (std::size_t at = bounds[chunk]; at < bounds[chunk + 1]; lines[chunk]++) {
+				std::size_t eol = std::min(text.find('\n', at), bounds[chunk + 1]);
+				line.assign(text, at, eol - at);
+				at = eol + 1;
+				record_fault fault = parse_record(line, record);
+				if (fault == record_valid)
+					parts[chunk].push_back(record);
+				else if (quarantine)
+					refused[chunk].push_back(refused_line { lines[chunk], fault, line });
+				else {
+					parse_record_leniently(line, record);
+					parts[chunk].push_back(record);
+				}
+			}
+		}
+	});
+	// the records start on line 2, after the header line
+	for (std::size_t chunk = 0, number = 2; chunk < parts.size(); number += lines[chunk++])
+		for (std::size_t indx = 0; indx < refused[chunk].size(); indx++)
+			quarantine->add(path, number + refused[chunk][indx].line, refused[chunk][indx].fault,
+					refused[chunk][indx].text);
+	std::size_t total = 0;
+	for (std::size_t chunk = 0; chunk < parts.size(); chunk++)
+		total += parts[chunk].size();
+	data.reserve(total);
+	for (std::size_t chunk = 0; chunk < parts.size(); chunk++)
+		data.insert(data.end(), parts[chunk].begin(), parts[chunk].end());
+	return true;
+}
+
+// the batch files named by a path: the file itself, the files of a directory or the files
+// a glob pattern matches, in name order (users are numbered in the order they are met)
+inline std::vector<std::string> expand_batch_path(const std::string& path) {
+	std::vector<std::string> files;
+	std::string pattern = path;
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0) {
+		if (!S_ISDIR(info.st_mode)) {
+			files.push_back(path);
+			return files;
+		}
+		pattern = path + "/*";
+	}
+	glob_t matches;
+	if (glob(pattern.c_str(), 0, 0, &matches) == 0)
+		for (std::size_t indx = 0; indx < matches.gl_pathc; indx++)
+			if (stat(matches.gl_pathv[indx], &info) == 0 && S_ISREG(info.st_mode))
+				files.push_back(matches.gl_pathv[indx]);
+	globfree(&matches);
+	if (files.empty() && pattern == path)
+		files.push_back(path); // a missing file is reported by the reader
+	return files;
+}
+
+// reads the records of a batch payment file on the calling thread, false if it cannot be read
+inline bool read_batch_file(const std::string& path, data_t& data, quarantine_log* quarantine = 0) {
+	data.clear();
+	std::ifstream file(path.c_str());
+	std::string line;
+	std::getline(file, line); // the header line
+	payment_t record;
+	for (unsigned long number = 2; std::getline(file, line); number++)
+		if (read_record(line, record, quarantine, path, number))
+			data.push_back(record);
+	return file.eof();
+}
+
+// reads every batch file into a part of its own, returns the index of the first file that
+// could not be read (files.size() when all of them were)
+inline std::size_t read_batches(const std::vector<std::string>& files, std::vector<data_t>& parts, thread_pool& pool,
+		quarantine_log* quarantine = 0) {
+	parts.assign(files.size(), data_t());
+	std::vector<char> failed(files.size(), 0);
+	if (files.size() < pool.size()) {
+		for (std::size_t indx = 0; indx < files.size(); indx++)
+			failed[indx] = !read_batch_parallel(files[indx], parts[indx], pool, quarantine);
+	} else {
+		pool.parallel_for(0, files.size(), 1, [&](std::size_t first, std::size_t last, unsigned worker) {
+			for (std::size_t indx = first; indx < last; indx++)
+				failed[indx] = !read_batch_file(files[indx], parts[indx], quarantine);
+		});
+	}
+	return std::find(failed.begin(), failed.end(), 1) - failed.begin();
+}
+
+#endif /* BATCH_LOADER_H_ */
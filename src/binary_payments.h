@@ -0,0 +1,243 @@
+/*
+ * binary_payments.h
+ *
+ * Fixed width binary payment records, for upstream producers that can emit
+ * them instead of CSV text. A file is mapped into memory and its records are
+ * read in place: the batch build takes the ids straight from the mapping, and
+ * a stream feed only materialises the text fields of the records it hands
+ * out. The paymo-convert tool converts CSV files to and from the format.
+ *
+ * Layout, every integer little endian:
+ *
+ *   header (32 bytes)
+ *     0  char[8]  magic "PAYMOBIN"
+ *     8  uint32   format version (1)
+ *    12  uint32   record size in bytes (32)
+ *    16  uint64   number of records
+ *    24  uint64   size of the message blob in bytes
+ *   records (32 bytes each, in stream order)
+ *     0  int64    time, seconds since 1970-01-01 UTC (-1 when the timestamp was invalid)
+ *     8  int32    id1, the payer
+ *    12  int32    id2, the payee
+ *    16  int64    amount in cents
+ *    24  uint32   offset of the message in the blob
+ *    28  uint32   length of the message in bytes
+ *   blob: the messages back to back, as they followed the comma in the CSV
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef BINARY_PAYMENTS_H_
+#define BINARY_PAYMENTS_H_
+
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "payment.h"
+
+const char binary_payments_magic[8] = { 'P', 'A', 'Y', 'M', 'O', 'B', 'I', 'N' };
+const uint32_t binary_payments_version = 1;
+
+struct binary_payments_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t records;
+	uint64_t blob_size;
+};
+
+struct binary_payment {
+	int64_t epoch;
+	int32_t id1;
+	int32_t id2;
+	int64_t cents;
+	uint32_t message_offset;
+	uint32_t message_length;
+};
+
+static_assert(sizeof(binary_payments_header) == 32, "the header is 32 bytes");
+static_assert(sizeof(binary_payment) == 32, "a record is 32 bytes");
+
+// the file is little endian, a big endian host swaps every field as it reads it
+template <typename T>
+inline T from_little_endian(T value) {
+	if constexpr (std::endian::native == std::endian::big) {
+		if constexpr (sizeof(T) == 8)
+			return (T) __builtin_bswap64((uint64_t) value);
+		else
+			return (T) __builtin_bswap32((uint32_t) value);
+	}
+	return value;
+}
+
+template <typename T>
+inline T to_little_endian(T value) { return from_little_endian(value); }
+
+/* A binary payment file mapped read only. The header is checked against the
+ * size of the file when it is opened, so reading any record is safe after; a
+ * message reaching out of the blob is read as an empty one. */
+class binary_payment_file {
+private:
+	void* mapping;
+	std::size_t mapping_size;
+	const binary_payment* records;
+	const char* blob;
+	uint64_t blob_size;
+	std::size_t count;
+
+	binary_payment_file(const binary_payment_file&);
+	binary_payment_file& operator=(const binary_payment_file&);
+public:
+	binary_payment_file() : mapping(0), mapping_size(0), records(0), blob(0), blob_size(0), count(0) {}
+
+	~binary_payment_file() {
+		if (mapping)
+			munmap(mapping, mapping_size);
+	}
+
+	// whether path is a regular file starting with the magic (FIFOs are never read from)
+	static bool detect(const std::string& path) {
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+			return false;
+		char magic[sizeof(binary_payments_magic)];
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		bool found = pread(fd, magic, sizeof(magic), 0) == (ssize_t) sizeof(magic)
+				&& std::memcmp(magic, binary_payments_magic, sizeof(magic)) == 0;
+		::close(fd);
+		return found;
+	}
+
+	// maps a binary payment file, false if it cannot be read or its layout does not add up
+	bool open(const std::string& path) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat info;
+		binary_payments_header header;
+		bool valid = fstat(fd, &info) == 0
+				&& pread(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header)
+				&& std::memcmp(header.magic, binary_payments_magic, sizeof(header.magic)) == 0
+				&& from_little_endian(header.version) == binary_payments_version
+				&& from_little_endian(header.record_size) == sizeof(binary_payment);
+		uint64_t records_size = from_little_endian(header.records) * sizeof(binary_payment);
+		valid = valid && (uint64_t) info.st_size == sizeof(header) + records_size + from_little_endian(header.blob_size);
+		if (valid) {
+			mapping_size = info.st_size;
+			mapping = mmap(0, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping == MAP_FAILED)
+				mapping = 0;
+			valid = mapping != 0;
+		}
+		::close(fd);
+		if (!valid)
+			return false;
+		madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+		records = (const binary_payment*) ((const char*) mapping + sizeof(header));
+		blob = (const char*) (records) + records_size;
+		count = from_little_endian(header.records);
+		blob_size = from_little_endian(header.blob_size);
+		return true;
+	}
+
+	std::size_t size() const { return count; }
+	long epoch(std::size_t indx) const { return from_little_endian(records[indx].epoch); }
+	int id1(std::size_t indx) const { return from_little_endian(records[indx].id1); }
+	int id2(std::size_t indx) const { return from_little_endian(records[indx].id2); }
+	long cents(std::size_t indx) const { return from_little_endian(records[indx].cents); }
+
+	// the record as a payment, with the text fields formatted the way the CSV reader leaves them
+	void get(std::size_t indx, payment_t& payment) const {
+		const binary_payment& record = records[indx];
+		payment.epoch = epoch(indx);
+		payment.time = payment.epoch == invalid_epoch ? std::string() : format_timestamp(payment.epoch);
+		payment.id1 = id1(indx);
+		payment.id2 = id2(indx);
+		long amount = cents(indx);
+		char text[32];
+		std::snprintf(text, sizeof(text), " %s%ld.%02ld", amount < 0 ? "-" : "", std::labs(amount) / 100,
+				std::labs(amount) % 100);
+		payment.amount = text;
+		uint64_t offset = from_little_endian(record.message_offset);
+		uint64_t length = from_little_endian(record.message_length);
+		if (offset + length <= blob_size)
+			payment.message.assign(blob + offset, length);
+		else
+			payment.message.clear();
+		payment.duplicate = false;
+		payment.malformed = false;
+		payment.scoring = score_full;
+	}
+};
+
+/* Writes a binary payment file: the records are written as they come, the
+ * messages are kept aside and appended as the blob when the file is closed,
+ * and the header is written last. */
+class binary_payment_writer {
+private:
+	std::FILE* file;
+	std::string blob;
+	uint64_t count;
+	bool failed;
+
+	binary_payment_writer(const binary_payment_writer&);
+	binary_payment_writer& operator=(const binary_payment_writer&);
+public:
+	binary_payment_writer() : file(0), count(0), failed(false) {}
+
+	~binary_payment_writer() {
+		if (file)
+			std::fclose(file);
+	}
+
+	bool open(const std::string& path) {
+		file = std::fopen(path.c_str(), "wb");
+		binary_payments_header header;
+		std::memset(&header, 0, sizeof(header)); // rewritten by close
+		return file && std::fwrite(&header, sizeof(header), 1, file) == 1;
+	}
+
+	void write(const payment_t& payment) {
+		binary_payment record;
+		record.epoch = to_little_endian((int64_t) payment.epoch);
+		record.id1 = to_little_endian((int32_t) payment.id1);
+		record.id2 = to_little_endian((int32_t) payment.id2);
+		record.cents = to_little_endian((int64_t) std::llround(std::atof(payment.amount.c_str()) * 100));
+		record.message_offset = to_little_endian((uint32_t) blob.size());
+		record.message_length = to_little_endian((uint32_t) payment.message.size());
+		blob.append(payment.message);
+		failed = failed || std::fwrite(&record, sizeof(record), 1, file) != 1;
+		count++;
+	}
+
+	// appends the blob and writes the header, false if any write failed
+	bool close() {
+		binary_payments_header header;
+		std::memcpy(header.magic, binary_payments_magic, sizeof(header.magic));
+		header.version = to_little_endian(binary_payments_version);
+		header.record_size = to_little_endian((uint32_t) sizeof(binary_payment));
+		header.records = to_little_endian(count);
+		header.blob_size = to_little_endian((uint64_t) blob.size());
+		failed = failed || (!blob.empty() && std::fwrite(blob.data(), blob.size(), 1, file) != 1)
+				|| std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file) != 1;
+		failed = std::fclose(file) != 0 || failed;
+		file = 0;
+		return !failed;
+	}
+
+	uint64_t records() const { return count; }
+};
+
+#endif /* BINARY_PAYMENTS_H_ */
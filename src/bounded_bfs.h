@@ -0,0 +1,315 @@
+/*
+ * bounded_bfs.h
+ *
+ * Breadth first search bounded to a maximum distance, used to establish the
+ * friendship degree of a payment. Unlike boost::breadth_first_search it does
+ * not initialise a colour and distance map over the whole graph for every
+ * query, and it can prune vertices that cannot lead to the target in time.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef BOUNDED_BFS_H_
+#define BOUNDED_BFS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "thread_pool.h"
+
+// never prunes anything (plain bounded search)
+struct no_pruning {
+	bool operator()(std::size_t vertex, int distance) const { return false; }
+};
+
+// whether a pruning predicate may be called from several threads at once (only those
+// are used by the parallel expansion of giant frontiers)
+template <typename Prune>
+struct concurrent_prune {
+	static const bool value = false;
+};
+template <>
+struct concurrent_prune<no_pruning> {
+	static const bool value = true;
+};
+
+// cache hints of a graph for the vertex record and its neighbour list, graphs that
+// provide none are searched without prefetching
+template <typename Graph>
+inline void prefetch_vertex(std::size_t v, const Graph& g) {}
+template <typename Graph>
+inline void prefetch_adjacency(std::size_t v, const Graph& g) {}
+
+// storage hint of a graph for a whole level before it is expanded: the frontier may be
+// reordered (a level is a set, its order does not change the search), graphs held in
+// memory need none
+template <typename Graph>
+inline void schedule_frontier(std::vector<std::size_t>& frontier, const Graph& g) {}
+
+const std::size_t frontier_block = 32; // vertices per prefetch stage
+const std::size_t visited_lookahead = 4; // vertices ahead whose neighbours' stamps are prefetched
+const std::size_t frontier_chunk = 256; // vertices per sorted chunk of the frontier
+const std::size_t parallel_frontier = 4096; // frontiers at least this large are expanded in parallel
+const std::size_t parallel_grain = 256; // frontier vertices per parallel task
+const unsigned long deadline_stride = 1024; // edge visits between two reads of the clock
+
+/* The search runs level by level. Visited vertices are marked with the stamp
+ * of the current query, so starting a new query costs nothing (the marks are
+ * only cleared when the 32-bit stamp wraps around). Vertices at the maximum
+ * distance are never expanded, and a vertex for which prune(vertex, distance)
+ * holds is visited but not expanded either.
+ *
+ * Every adjacency fetch is a chain of dependent cache misses (vertex record,
+ * neighbour list, visited stamps of the neighbours), so the frontier is walked
+ * in blocks with the loads issued ahead: the records two blocks ahead, the
+ * neighbour lists one block ahead, and the visited stamps of the neighbours of
+ * a vertex a few steps ahead. Optionally the next frontier is sorted in chunks
+ * so that records and stamps are touched in address order; the sort costs more
+ * than it saves while the network fits in the last level cache, so it is off
+ * by default (see fraud-alert-bench). A graph kept on disk schedules the reads
+ * of every level before it is expanded instead (see disk_graph.h).
+ *
+ * A level whose frontier is giant is expanded by the thread pool instead: the
+ * threads claim the visited stamps with an atomic exchange and append to their
+ * own next frontier, the buffers are concatenated once the level is done.
+ * Smaller levels stay sequential and never touch an atomic.
+ *
+ * A distance query can be given a budget of edge visits or of time. A query
+ * that exhausts it gives up and reports the distance it has proven so far:
+ * the target was not met on the levels already completed, so it is at least
+ * as far as the level being expanded (pruning only drops vertices that cannot
+ * reach the target in time, which keeps the bound valid). The clock is read
+ * every deadline_stride edge visits and at every level.
+ */
+class bounded_bfs {
+private:
+	std::vector<uint32_t> visited; // stamp of the last query that visited the vertex
+	uint32_t stamp;
+	std::vector<std::size_t> frontier;
+	std::vector<std::size_t> next_frontier;
+	bool prefetching;
+	bool sorting;
+	thread_pool* pool; // null for a sequential search
+	std::vector<std::vector<std::size_t> > local_next; // next frontier of each pool thread
+	unsigned long parallel; // levels expanded in parallel
+	unsigned long edge_budget; // edge visits a distance query may use, 0 for no limit
+	std::chrono::steady_clock::duration deadline; // time a distance query may use, zero for no limit
+	std::chrono::steady_clock::time_point started;
+	unsigned long visits; // edge visits of the current query
+	unsigned long next_check; // visits at which the budget is checked again
+	int proven; // distance proven by the last query cut short
+	unsigned long overruns; // queries cut short
+
+	void start_query(std::size_t vertices) {
+		if (visited.size() < vertices)
+			visited.resize(vertices + vertices / 2, 0);
+		if (++stamp == 0) {
+			std::fill(visited.begin(), visited.end(), 0);
+			stamp = 1;
+		}
+	}
+
+	// issues the loads ahead of expanding frontier[indx]
+	template <typename Graph>
+	void prefetch_ahead(const Graph& g, std::size_t indx) {
+		std::size_t size = frontier.size();
+		if (indx == 0) {
+			// the first two blocks have nothing ahead of them
+			for (std::size_t ahead = 0; ahead < std::min(size, 2 * frontier_block); ahead++)
+				prefetch_vertex(frontier[ahead], g);
+			for (std::size_t ahead = 0; ahead < std::min(size, frontier_block); ahead++)
+				prefetch_adjacency(frontier[ahead], g);
+		}
+		if (indx % frontier_block == 0) {
+			for (std::size_t ahead = indx + 2 * frontier_block; ahead < std::min(size, indx + 3 * frontier_block); ahead++)
+				prefetch_vertex(frontier[ahead], g);
+			for (std::size_t ahead = indx + frontier_block; ahead < std::min(size, indx + 2 * frontier_block); ahead++)
+				prefetch_adjacency(frontier[ahead], g);
+		}
+		if (indx + visited_lookahead < size) {
+			typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+			boost::tie(vi, vi_end) = adjacent_vertices(frontier[indx + visited_lookahead], g);
+			for (unsigned count = 0; vi != vi_end && count < 16; ++vi, count++)
+				__builtin_prefetch(&visited[*vi]);
+		}
+	}
+
+	// expands the whole frontier on the pool, true if the target was met
+	template <typename Graph, typename Prune>
+	bool expand_parallel(const Graph& g, std::size_t target, int depth, int max_distance, Prune prune) {
+		std::atomic<bool> found(false);
+		uint32_t* marks = &visited[0];
+		uint32_t current = stamp;
+		local_next.resize(pool->size());
+		for (std::size_t worker = 0; worker < local_next.size(); worker++)
+			local_next[worker].clear();
+		pool->parallel_for(0, frontier.size(), parallel_grain, [&](std::size_t first, std::size_t last, unsigned worker) {
+			std::vector<std::size_t>& local = local_next[worker];
+			typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+			for (std::size_t indx = first; indx < last && !found.load(std::memory_order_relaxed); indx++) {
+				for (boost::tie(vi, vi_end) = adjacent_vertices(frontier[indx], g); vi != vi_end; ++vi) {
+					std::size_t y = *vi;
+					if (y == target) {
+						found.store(true, std::memory_order_relaxed);
+						return;
+					}
+					if (__atomic_load_n(&marks[y], __ATOMIC_RELAXED) == current
+							|| __atomic_exchange_n(&marks[y], current, __ATOMIC_RELAXED) == current)
+						continue; // visited before or claimed by another thread
+					if (depth < max_distance && !prune(y, depth))
+						local.push_back(y);
+				}
+			}
+		});
+		parallel++;
+		if (found.load())
+			return true;
+		for (std::size_t worker = 0; worker < local_next.size(); worker++)
+			next_frontier.insert(next_frontier.end(), local_next[worker].begin(), local_next[worker].end());
+		return false;
+	}
+
+	bool limited() const { return edge_budget > 0 || deadline.count() > 0; }
+
+	void start_budget() {
+		visits = 0;
+		next_check = edge_budget > 0 ? std::min(edge_budget, deadline_stride) : deadline_stride;
+		if (deadline.count() > 0)
+			started = std::chrono::steady_clock::now();
+	}
+
+	// true once the query used its budget, otherwise schedules the next check
+	bool out_of_budget() {
+		if (edge_budget > 0 && visits >= edge_budget)
+			return true;
+		if (deadline.count() > 0 && std::chrono::steady_clock::now() - started > deadline)
+			return true;
+		next_check = visits + deadline_stride;
+		if (edge_budget > 0)
+			next_check = std::min(next_check, edge_budget);
+		return false;
+	}
+
+	// gives up the query while expanding the given level
+	int overrun(int depth, int max_distance) {
+		proven = depth;
+		overruns++;
+		return max_distance + 1;
+	}
+
+	void next_level() {
+		if (sorting)
+			for (std::size_t first = 0; first < next_frontier.size(); first += frontier_chunk)
+				std::sort(next_frontier.begin() + first,
+						next_frontier.begin() + std::min(next_frontier.size(), first + frontier_chunk));
+		frontier.swap(next_frontier);
+	}
+public:
+	bounded_bfs() : stamp(0), prefetching(false), sorting(false), pool(0), parallel(0), edge_budget(0),
+		deadline(0), visits(0), next_check(0), proven(0), overruns(0) {}
+
+	// giant frontiers are expanded on the pool (null keeps every level sequential)
+	void set_pool(thread_pool* threads) { pool = threads; }
+	unsigned long parallel_levels() const { return parallel; }
+
+	// prefetching and frontier sorting are off by default, neither has shown a gain on the
+	// PayMo networks (see fraud-alert-bench), they can be turned on for comparison (see
+	// --prefetch and --frontier-sort)
+	void set_prefetching(bool enabled) { prefetching = enabled; }
+	void set_frontier_sorting(bool enabled) { sorting = enabled; }
+
+	// distance queries give up after visiting edges edges or running for microseconds (0 for
+	// no limit); explore is never limited
+	void set_budget(unsigned long edges, unsigned long microseconds) {
+		edge_budget = edges;
+		deadline = std::chrono::microseconds(microseconds);
+	}
+	// distance queries that ran out of budget, and the lower bound the last of them proved
+	unsigned long overrun_count() const { return overruns; }
+	int proven_distance() const { return proven; }
+
+	// distance between source and target, or max_distance + 1 if it exceeds max_distance
+	template <typename Graph, typename Prune>
+	int distance(const Graph& g, std::size_t source, std::size_t target, int max_distance, Prune prune) {
+		if (source == target)
+			return 0;
+		start_query(num_vertices(g));
+		bool budgeted = limited();
+		if (budgeted)
+			start_budget();
+		visited[source] = stamp;
+		frontier.assign(1, source);
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (int depth = 1; depth <= max_distance && !frontier.empty(); depth++) {
+			next_frontier.clear();
+			schedule_frontier(frontier, g);
+			if (budgeted && out_of_budget())
+				return overrun(depth, max_distance);
+			if (pool && pool->size() > 1 && frontier.size() >= parallel_frontier && concurrent_prune<Prune>::value) {
+				if (expand_parallel(g, target, depth, max_distance, prune))
+					return depth;
+				visits += frontier.size(); // at least one visit per expanded vertex
+				next_level();
+				continue;
+			}
+			for (std::size_t indx = 0; indx < frontier.size(); indx++) {
+				if (prefetching)
+					prefetch_ahead(g, indx);
+				for (boost::tie(vi, vi_end) = adjacent_vertices(frontier[indx], g); vi != vi_end; ++vi) {
+					std::size_t y = *vi;
+					if (y == target)
+						return depth;
+					if (budgeted && ++visits >= next_check && out_of_budget())
+						return overrun(depth, max_distance);
+					if (visited[y] == stamp)
+						continue;
+					visited[y] = stamp;
+					if (depth < max_distance && !prune(y, depth))
+						next_frontier.push_back(y);
+				}
+			}
+			next_level();
+		}
+		return max_distance + 1;
+	}
+
+	template <typename Graph>
+	int distance(const Graph& g, std::size_t source, std::size_t target, int max_distance) {
+		return distance(g, source, target, max_distance, no_pruning());
+	}
+
+	// visits the ball of radius max_distance around source without a target, calling
+	// visit(vertex, distance) once per vertex; a vertex for which it holds is not expanded
+	template <typename Graph, typename Visit>
+	void explore(const Graph& g, std::size_t source, int max_distance, Visit visit) {
+		start_query(num_vertices(g));
+		visited[source] = stamp;
+		frontier.assign(1, source);
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (int depth = 1; depth <= max_distance && !frontier.empty(); depth++) {
+			next_frontier.clear();
+			schedule_frontier(frontier, g);
+			for (std::size_t indx = 0; indx < frontier.size(); indx++) {
+				if (prefetching)
+					prefetch_ahead(g, indx);
+				for (boost::tie(vi, vi_end) = adjacent_vertices(frontier[indx], g); vi != vi_end; ++vi) {
+					std::size_t y = *vi;
+					if (visited[y] == stamp)
+						continue;
+					visited[y] = stamp;
+					if (!visit(y, depth) && depth < max_distance)
+						next_frontier.push_back(y);
+				}
+			}
+			next_level();
+		}
+	}
+};
+
+#endif /* BOUNDED_BFS_H_ */
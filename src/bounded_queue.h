@@ -0,0 +1,80 @@
+/*
+ * bounded_queue.h
+ *
+ * A blocking queue with a fixed capacity used to hand work between threads.
+ * Producers block while the queue is full, so a fast producer can never
+ * run ahead of its consumer by more than the queue capacity.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef BOUNDED_QUEUE_H_
+#define BOUNDED_QUEUE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+template <typename T>
+class bounded_queue {
+private:
+	std::deque<T> items;
+	std::size_t capacity;
+	bool closed;
+	std::mutex lock;
+	std::condition_variable not_empty;
+	std::condition_variable not_full;
+public:
+	explicit bounded_queue(std::size_t capacity) :
+		capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+	// blocks until there is room for the item, returns false if the queue was closed
+	bool push(T item) {
+		std::unique_lock<std::mutex> guard(lock);
+		not_full.wait(guard, [this] { return closed || items.size() < capacity; });
+		if (closed)
+			return false;
+		items.push_back(std::move(item));
+		not_empty.notify_one();
+		return true;
+	}
+
+	// never blocks, returns false if the queue is full or closed
+	bool try_push(T item) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (closed || items.size() >= capacity)
+			return false;
+		items.push_back(std::move(item));
+		not_empty.notify_one();
+		return true;
+	}
+
+	// blocks until an item is available, returns false once the queue is closed and drained
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> guard(lock);
+		not_empty.wait(guard, [this] { return closed || !items.empty(); });
+		if (items.empty())
+			return false;
+		item = std::move(items.front());
+		items.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+
+	// no more items will be pushed, consumers drain what is left
+	void close() {
+		std::lock_guard<std::mutex> guard(lock);
+		closed = true;
+		not_empty.notify_all();
+		not_full.notify_all();
+	}
+
+	std::size_t size() {
+		std::lock_guard<std::mutex> guard(lock);
+		return items.size();
+	}
+};
+
+#endif /* BOUNDED_QUEUE_H_ */
@@ -0,0 +1,81 @@
+/*
+ * components.h
+ *
+ * Connected components of the payment network, kept incrementally with a
+ * union-find forest. Two users in different components are beyond any
+ * degree, which the service mode uses as a cheap signal when it has no time
+ * for a search.
+ * REF: Tarjan, "Efficiency of a Good But Not Linear Set Union Algorithm" (JACM 1975)
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef COMPONENTS_H_
+#define COMPONENTS_H_
+
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/graph/graph_traits.hpp>
+
+/* Union by size and path halving: every find runs in amortised inverse
+ * Ackermann time, a handful of steps on any real network. Edges are only ever
+ * added, so components only ever merge. */
+class union_find {
+private:
+	std::vector<uint32_t> parent;
+	std::vector<uint32_t> sizes;
+	std::size_t count;
+public:
+	union_find() : count(0) {}
+
+	template <typename Graph>
+	void build(const Graph& g) {
+		parent.clear();
+		sizes.clear();
+		count = 0;
+		for (std::size_t v = 0; v < num_vertices(g); v++)
+			add_vertex();
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (std::size_t v = 0; v < num_vertices(g); v++)
+			for (boost::tie(vi, vi_end) = adjacent_vertices(v, g); vi != vi_end; ++vi)
+				if (v < *vi)
+					unite(v, *vi);
+	}
+
+	// a new user is a component of its own
+	void add_vertex() {
+		parent.push_back(parent.size());
+		sizes.push_back(1);
+		count++;
+	}
+
+	std::size_t find(std::size_t v) {
+		while (parent[v] != v) {
+			parent[v] = parent[parent[v]];
+			v = parent[v];
+		}
+		return v;
+	}
+
+	void unite(std::size_t a, std::size_t b) {
+		a = find(a);
+		b = find(b);
+		if (a == b)
+			return;
+		if (sizes[a] < sizes[b])
+			std::swap(a, b);
+		parent[b] = a;
+		sizes[a] += sizes[b];
+		count--;
+	}
+
+	bool connected(std::size_t a, std::size_t b) { return find(a) == find(b); }
+
+	std::size_t components() const { return count; }
+	std::size_t memory() const { return (parent.capacity() + sizes.capacity()) * sizeof(uint32_t); }
+};
+
+#endif /* COMPONENTS_H_ */
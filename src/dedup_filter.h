@@ -0,0 +1,255 @@
+/*
+ * dedup_filter.h
+ *
+ * Duplicate payment suppression. Upstream retries deliver the very same
+ * record more than once, every record is fingerprinted and checked against
+ * the records of a rolling time window before it reaches the scorer.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef DEDUP_FILTER_H_
+#define DEDUP_FILTER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hash.h"
+#include "payment.h"
+
+/* Cuckoo filter with 16-bit fingerprints in buckets of four slots. A key can
+ * live in one of two buckets, the second one derived from the first and the
+ * fingerprint, so entries can be kicked between their buckets while the
+ * table fills up. At 95% load the false positive rate is about 8/2^16.
+ * REF: Fan et al., "Cuckoo Filter: Practically Better Than Bloom" (CoNEXT 2014)
+ *
+ * Beside every fingerprint the table keeps a 64-bit check word, a second
+ * independent hash of the key, in a parallel array that is only read when the
+ * fingerprint matches (and moves with it when it is kicked). A lookup then
+ * only matches another key if the bucket, the fingerprint and the check word
+ * all collide, about 80 bits of two independent hashes, so the filter is its
+ * own exact store: 10 bytes per key, whatever the length of the key.
+ */
+class cuckoo_filter {
+private:
+	static const unsigned slots = 4;
+	static const unsigned max_kicks = 500;
+
+	std::vector<uint16_t> table; // buckets * slots fingerprints, 0 marks an empty slot
+	std::vector<uint64_t> checks; // check word of the fingerprint in the same slot
+	uint64_t mask;
+	std::size_t count;
+	uint64_t victim_seed;
+	bool has_victim; // fingerprint left homeless by the last failed insertion
+	uint16_t victim_fp;
+	uint64_t victim_check;
+	uint64_t victim_bucket;
+
+	static uint16_t fingerprint(uint64_t hash) {
+		uint16_t fp = (uint16_t) (hash >> 48);
+		return fp ? fp : 1;
+	}
+
+	uint64_t alternate(uint64_t bucket, uint16_t fp) const {
+		return (bucket ^ mix64(fp)) & mask;
+	}
+
+	bool insert_into(uint64_t bucket, uint16_t fp, uint64_t check) {
+		for (unsigned s = 0; s < slots; s++) {
+			if (table[bucket * slots + s] == 0) {
+				table[bucket * slots + s] = fp;
+				checks[bucket * slots + s] = check;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool bucket_has(uint64_t bucket, uint16_t fp, uint64_t check) const {
+		for (unsigned s = 0; s < slots; s++)
+			if (table[bucket * slots + s] == fp && checks[bucket * slots + s] == check)
+				return true;
+		return false;
+	}
+public:
+	// sized to hold capacity keys at no more than 95% load
+	explicit cuckoo_filter(std::size_t capacity) : count(0), victim_seed(0),
+		has_victim(false), victim_fp(0), victim_check(0), victim_bucket(0) {
+		uint64_t buckets = 1;
+		while (buckets * slots * 95 < capacity * 100)
+			buckets <<= 1;
+		table.assign(buckets * slots, 0);
+		checks.assign(buckets * slots, 0);
+		mask = buckets - 1;
+	}
+
+	// returns false when the filter is too full to take the key
+	bool insert(uint64_t hash, uint64_t check) {
+		if (has_victim)
+			return false;
+		uint16_t fp = fingerprint(hash);
+		uint64_t b1 = hash & mask;
+		uint64_t b2 = alternate(b1, fp);
+		if (insert_into(b1, fp, check) || insert_into(b2, fp, check)) {
+			count++;
+			return true;
+		}
+		uint64_t bucket = (victim_seed++ & 1) ? b1 : b2;
+		for (unsigned kick = 0; kick < max_kicks; kick++) {
+			unsigned s = (unsigned) (mix64(victim_seed++) % slots);
+			std::swap(fp, table[bucket * slots + s]);
+			std::swap(check, checks[bucket * slots + s]);
+			bucket = alternate(bucket, fp);
+			if (insert_into(bucket, fp, check)) {
+				count++;
+				return true;
+			}
+		}
+		// the key is in, but the last fingerprint kicked out has no room left: it is kept
+		// aside so lookups stay exact, and the filter refuses further insertions
+		has_victim = true;
+		victim_fp = fp;
+		victim_check = check;
+		victim_bucket = bucket;
+		count++;
+		return true;
+	}
+
+	bool contains(uint64_t hash, uint64_t check) const {
+		uint16_t fp = fingerprint(hash);
+		uint64_t b1 = hash & mask;
+		uint64_t b2 = alternate(b1, fp);
+		if (has_victim && victim_fp == fp && victim_check == check && (victim_bucket == b1 || victim_bucket == b2))
+			return true;
+		return bucket_has(b1, fp, check) || bucket_has(b2, fp, check);
+	}
+
+	std::size_t size() const { return count; }
+	std::size_t capacity() const { return table.size() * 95 / 100; }
+	bool full() const { return has_victim || count >= capacity(); }
+	std::size_t memory() const { return table.capacity() * sizeof(uint16_t) + checks.capacity() * sizeof(uint64_t); }
+};
+
+// what happens to a payment recognised as a duplicate
+enum dedup_policy {
+	dedup_drop, // the payment is not handed to the scorer
+	dedup_mark // the payment is handed over with payment.duplicate set
+};
+
+const std::size_t min_generation = 1024; // keys the first generation is sized for
+const uint64_t check_seed = 0x243f6a8885a308d3ULL; // seed of the check word hash
+
+/* dedup_filter is a stage between the stream and the scorer. The window is
+ * covered by generations of about window/generations seconds, each with its
+ * own cuckoo filter, and a generation is dropped as a whole once all of its
+ * payments are older than the window. A generation is sized from the payments
+ * of the one before it, with a quarter more room (min_generation for the
+ * first); one that fills up before its time closes early and the next one is
+ * sized twice as large. The memory thus follows the payments of the window
+ * rather than a fixed capacity, and the capacity only caps the keys held over
+ * the whole window: beyond it the oldest generation is dropped before its
+ * time, and the window shrinks.
+ */
+class dedup_filter : public payment_source {
+private:
+	struct generation {
+		long start;
+		cuckoo_filter filter;
+		generation(long start, std::size_t capacity) : start(start), filter(capacity) {}
+	};
+
+	payment_source& upstream;
+	dedup_policy policy;
+	long window;
+	long span; // seconds covered by a generation
+	std::size_t capacity; // keys held over the whole window at most
+	std::deque<generation> generations; // newest generation at the back
+	std::size_t held; // keys the generations are sized for
+	std::string key;
+	unsigned long duplicate_count;
+	unsigned long shortened; // generations dropped before their time to stay within the capacity
+	// bytes of the window, kept up to date by the thread pulling the payments so that
+	// memory() can be read from another one (the admission stage pulls on its own thread)
+	std::atomic<std::size_t> bytes;
+
+	// canonical form of the fields identifying a payment
+	void build_key(const payment_t& payment) {
+		key.assign(payment.time);
+		key.push_back('\0');
+		key.append(reinterpret_cast<const char*>(&payment.id1), sizeof(payment.id1));
+		key.append(reinterpret_cast<const char*>(&payment.id2), sizeof(payment.id2));
+		key.append(payment.amount);
+		key.push_back('\0');
+		key.append(payment.message);
+	}
+
+	bool seen(uint64_t hash, uint64_t check) const {
+		for (std::deque<generation>::const_iterator gen = generations.begin(); gen != generations.end(); ++gen)
+			if (gen->filter.contains(hash, check))
+				return true;
+		return false;
+	}
+
+	void drop_oldest() {
+		held -= generations.front().filter.capacity();
+		bytes -= sizeof(generation) + generations.front().filter.memory();
+		generations.pop_front();
+	}
+
+	void remember(uint64_t hash, uint64_t check, long epoch) {
+		// every payment of the oldest generation is older than the window once the next one started before it
+		while (generations.size() > 1 && generations[1].start <= epoch - window)
+			drop_oldest();
+		if (generations.empty() || epoch >= generations.back().start + span || generations.back().filter.full()) {
+			std::size_t expected = min_generation;
+			if (!generations.empty()) {
+				const cuckoo_filter& last = generations.back().filter;
+				expected = last.full() ? 2 * last.capacity() : last.size() + last.size() / 4;
+			}
+			expected = std::min(capacity, std::max(min_generation, expected));
+			while (!generations.empty() && held + expected > capacity) {
+				drop_oldest();
+				shortened++;
+			}
+			generations.emplace_back(epoch, expected);
+			held += generations.back().filter.capacity();
+			bytes += sizeof(generation) + generations.back().filter.memory();
+		}
+		generations.back().filter.insert(hash, check);
+	}
+public:
+	// window in seconds, capacity is the number of payments remembered over the whole window at most
+	dedup_filter(payment_source& upstream, long window, dedup_policy policy = dedup_mark,
+			std::size_t capacity = 1 << 22, unsigned generations = 4) :
+		upstream(upstream), policy(policy), window(window), span(window / generations > 0 ? window / generations : 1),
+		capacity(std::max(capacity, min_generation)), held(0), duplicate_count(0), shortened(0), bytes(0) {}
+
+	unsigned long duplicates() const { return duplicate_count; }
+	unsigned long shortened_windows() const { return shortened; }
+
+	std::size_t memory() const { return bytes.load(std::memory_order_relaxed); }
+
+	bool next(payment_t& payment) {
+		while (upstream.next(payment)) {
+			build_key(payment);
+			uint64_t hash = hash_bytes(key.data(), key.size());
+			uint64_t check = hash_bytes(key.data(), key.size(), check_seed);
+			if (seen(hash, check)) {
+				duplicate_count++;
+				if (policy == dedup_drop)
+					continue;
+				payment.duplicate = true;
+				return true;
+			}
+			remember(hash, check, payment.epoch);
+			return true;
+		}
+		return false;
+	}
+};
+
+#endif /* DEDUP_FILTER_H_ */
@@ -0,0 +1,356 @@
+/*
+ * disk_graph.h
+ *
+ * Semi-external payment network for networks larger than memory. The batch
+ * network is written once as a CSR file (an offset per vertex, then every
+ * neighbour list sorted, in vertex order, then the user id of every vertex)
+ * and the neighbour lists are mapped into memory from it; only the offsets
+ * stay resident, eight bytes per user. The file is built from the batch
+ * edges by an external sort, and a later run can map it again as it is.
+ * The edges added by the stream since are kept in an adaptive_graph next to
+ * it (its vertex records stay resident as well), and a vertex's neighbours are
+ * its stored list followed by its recent one.
+ * REF: Abello, Buchsbaum, Westbrook, "A Functional Approach to External Graph Algorithms" (Algorithmica 2002)
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef DISK_GRAPH_H_
+#define DISK_GRAPH_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "adjacency.h"
+
+const char disk_graph_magic[8] = { 'P', 'A', 'Y', 'M', 'O', 'C', 'S', 'R' };
+const uint64_t readahead_gap = 32; // pages between two lists below which they are read as one run
+const std::size_t readahead_level = 16; // smaller levels fault their few pages in as they go
+const std::size_t csr_run_entries = 1 << 21; // neighbour entries sorted in memory per run (16 MB)
+const std::size_t csr_merge_entries = 1 << 13; // entries read at a time from every run while merging
+
+struct disk_graph_header {
+	char magic[8];
+	uint64_t vertices;
+	uint64_t entries; // neighbour list entries, twice the edges
+};
+
+inline bool write_bytes(std::FILE* file, const void* data, std::size_t bytes) {
+	return bytes == 0 || std::fwrite(data, bytes, 1, file) == 1;
+}
+
+/* The CSR file is built from the edges as they are read, without the network
+ * being held in memory: the neighbour entries (vertex, neighbour) are gathered
+ * in a buffer that is sorted and written out as a run next to the file
+ * whenever it is full, and the runs are merged into the neighbour lists once
+ * every edge is in, repeated edges dropped on the way. Memory stays at the run
+ * buffer, a read buffer per run and the offsets, whatever the network size.
+ */
+class csr_writer {
+private:
+	struct run_reader {
+		std::FILE* file;
+		std::vector<uint64_t> entries;
+		std::size_t at;
+		bool refill() {
+			entries.resize(csr_merge_entries);
+			entries.resize(std::fread(&entries[0], sizeof(uint64_t), entries.size(), file));
+			at = 0;
+			return !entries.empty();
+		}
+	};
+
+	std::string path;
+	std::vector<uint64_t> buffer; // (vertex << 32 | neighbour) entries of the current run
+	std::vector<std::FILE*> runs; // unlinked once created, they are gone when closed
+	bool failed;
+
+	csr_writer(const csr_writer&);
+	csr_writer& operator=(const csr_writer&);
+
+	void spill() {
+		std::sort(buffer.begin(), buffer.end());
+		buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+		std::string name = path + ".run" + std::to_string(runs.size());
+		std::FILE* file = std::fopen(name.c_str(), "w+b");
+		std::remove(name.c_str());
+		if (file)
+			runs.push_back(file);
+		failed = failed || !file || !write_bytes(file, buffer.data(), buffer.size() * sizeof(uint64_t));
+		buffer.clear();
+	}
+public:
+	// the runs are written next to path, the file the network goes to
+	explicit csr_writer(const std::string& path) : path(path), failed(false) {}
+
+	~csr_writer() {
+		for (std::size_t indx = 0; indx < runs.size(); indx++)
+			std::fclose(runs[indx]);
+	}
+
+	void add_edge(std::size_t u, std::size_t v) {
+		buffer.push_back(((uint64_t) u << 32) | (uint32_t) v);
+		if (u != v)
+			buffer.push_back(((uint64_t) v << 32) | (uint32_t) u);
+		if (buffer.size() >= csr_run_entries)
+			spill();
+	}
+
+	// merges the runs into the CSR file of a network of labels.size() vertices, labels
+	// holding the user id of every vertex; false if the file could not be written
+	bool write(const std::vector<int32_t>& labels) {
+		spill();
+		std::FILE* file = std::fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+		disk_graph_header header;
+		std::memcpy(header.magic, disk_graph_magic, sizeof(header.magic));
+		header.vertices = labels.size();
+		header.entries = 0;
+		std::vector<uint64_t> starts(header.vertices + 1, 0);
+		// the lists go after the room of the offsets, which are only known once the lists are written
+		bool written = !failed && std::fseek(file, sizeof(header) + starts.size() * sizeof(uint64_t), SEEK_SET) == 0;
+
+		typedef std::pair<uint64_t, std::size_t> run_head; // next entry of a run, and the run
+		std::priority_queue<run_head, std::vector<run_head>, std::greater<run_head> > heads;
+		std::vector<run_reader> readers(runs.size());
+		for (std::size_t indx = 0; indx < runs.size() && written; indx++) {
+			readers[indx].file = runs[indx];
+			std::rewind(runs[indx]);
+			if (readers[indx].refill())
+				heads.push(std::make_pair(readers[indx].entries[0], indx));
+		}
+		std::vector<uint32_t> list; // neighbour entries waiting to be written
+		uint64_t last = ~(uint64_t) 0;
+		std::size_t vertex = 0;
+		while (!heads.empty() && written) {
+			run_head head = heads.top();
+			heads.pop();
+			run_reader& reader = readers[head.second];
+			if (++reader.at < reader.entries.size() || reader.refill())
+				heads.push(std::make_pair(reader.entries[reader.at], head.second));
+			if (head.first == last)
+				continue; // the same edge from another run
+			last = head.first;
+			std::size_t v = head.first >> 32;
+			if (v >= header.vertices) {
+				written = false;
+				break;
+			}
+			while (vertex < v)
+				starts[++vertex] = header.entries;
+			list.push_back((uint32_t) head.first);
+			header.entries++;
+			if (list.size() == csr_merge_entries) {
+				written = write_bytes(file, list.data(), list.size() * sizeof(uint32_t));
+				list.clear();
+			}
+		}
+		while (vertex < header.vertices)
+			starts[++vertex] = header.entries;
+		written = written && write_bytes(file, list.data(), list.size() * sizeof(uint32_t))
+				&& write_bytes(file, labels.data(), labels.size() * sizeof(int32_t))
+				&& std::fseek(file, 0, SEEK_SET) == 0 && write_bytes(file, &header, sizeof(header))
+				&& write_bytes(file, starts.data(), starts.size() * sizeof(uint64_t));
+		return std::fclose(file) == 0 && written;
+	}
+};
+
+/* The lists of a search level are fetched from the file in file order: the
+ * frontier is sorted by vertex, which is the order of the lists in the file,
+ * and the page ranges of its lists are coalesced into runs (lists less than
+ * readahead_gap pages apart share a run) that the kernel is asked to read ahead
+ * before the level is expanded. The random page faults of a level become a
+ * few sequential reads in flight together, and the mapping is advised random
+ * access so that no other read ahead competes with them. Levels of a handful
+ * of vertices are only sorted: they cost a few faults either way, and a read
+ * ahead request per level would mostly be spent on pages already resident.
+ *
+ * The file is never rewritten: the recent edges only grow in memory until
+ * the network is written out again.
+ */
+class disk_graph {
+public:
+	class adjacency_iterator {
+	private:
+		const uint32_t* at;
+		const uint32_t* stored_end;
+		const uint32_t* recent; // first recent neighbour, taken over once the stored ones are done
+	public:
+		adjacency_iterator() : at(0), stored_end(0), recent(0) {}
+		adjacency_iterator(const uint32_t* a, const uint32_t* a_end, const uint32_t* b) :
+			at(a == a_end ? b : a), stored_end(a_end), recent(b) {}
+		explicit adjacency_iterator(const uint32_t* end) : at(end), stored_end(0), recent(0) {}
+
+		std::size_t operator*() const { return *at; }
+		adjacency_iterator& operator++() {
+			if (++at == stored_end)
+				at = recent;
+			return *this;
+		}
+		bool operator==(const adjacency_iterator& other) const { return at == other.at; }
+		bool operator!=(const adjacency_iterator& other) const { return at != other.at; }
+	};
+private:
+	const adaptive_graph& recent_edges;
+	std::vector<uint64_t> offsets; // first entry of every stored vertex, and the end of the last one
+	void* mapping;
+	std::size_t mapping_size;
+	const uint32_t* stored; // the neighbour lists in the mapping
+	const int32_t* labels; // the user ids of the stored vertices in the mapping
+	uint64_t list_start; // file position of the neighbour lists
+	std::size_t page;
+	mutable unsigned long runs, pages; // read ahead requests, and the pages they covered
+
+	disk_graph(const disk_graph&);
+	disk_graph& operator=(const disk_graph&);
+
+	std::pair<const uint32_t*, const uint32_t*> stored_neighbours(std::size_t v) const {
+		if (v >= stored_vertices())
+			return std::make_pair(stored, stored);
+		return std::make_pair(stored + offsets[v], stored + offsets[v + 1]);
+	}
+
+	void advise(uint64_t first_page, uint64_t last_page) const {
+		madvise((char*) mapping + first_page * page, (last_page - first_page + 1) * page, MADV_WILLNEED);
+		runs++;
+		pages += last_page - first_page + 1;
+	}
+public:
+	typedef std::size_t vertex_descriptor;
+
+	explicit disk_graph(const adaptive_graph& recent) : recent_edges(recent), mapping(0), mapping_size(0),
+		stored(0), labels(0), list_start(0), page(sysconf(_SC_PAGESIZE)), runs(0), pages(0) {}
+
+	~disk_graph() {
+		if (mapping)
+			munmap(mapping, mapping_size);
+	}
+
+	// reads the offsets of a CSR file and maps its neighbour lists, false if the file is not one
+	bool open(const std::string& path) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		disk_graph_header header;
+		struct stat status;
+		bool valid = pread(fd, &header, sizeof(header), 0) == sizeof(header)
+				&& std::memcmp(header.magic, disk_graph_magic, sizeof(header.magic)) == 0 && fstat(fd, &status) == 0;
+		if (valid) {
+			list_start = sizeof(header) + (header.vertices + 1) * sizeof(uint64_t);
+			mapping_size = list_start + header.entries * sizeof(uint32_t) + header.vertices * sizeof(int32_t);
+			valid = (uint64_t) status.st_size == mapping_size;
+		}
+		if (valid) {
+			offsets.resize(header.vertices + 1);
+			std::size_t bytes = offsets.size() * sizeof(uint64_t);
+			valid = pread(fd, &offsets[0], bytes, sizeof(header)) == (ssize_t) bytes
+					&& offsets.back() == header.entries;
+		}
+		if (valid) {
+			mapping = mmap(0, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (mapping == MAP_FAILED)
+				mapping = 0;
+			valid = mapping != 0;
+		}
+		::close(fd);
+		if (!valid) {
+			offsets.clear();
+			return false;
+		}
+		madvise(mapping, mapping_size, MADV_RANDOM);
+		stored = (const uint32_t*) ((const char*) mapping + list_start);
+		labels = (const int32_t*) (stored + header.entries);
+		return true;
+	}
+
+	std::pair<adjacency_iterator, adjacency_iterator> neighbours(std::size_t v) const {
+		std::pair<const uint32_t*, const uint32_t*> a = stored_neighbours(v);
+		std::pair<adaptive_graph::adjacency_iterator, adaptive_graph::adjacency_iterator> b = recent_edges.neighbours(v);
+		return std::make_pair(adjacency_iterator(a.first, a.second, b.first), adjacency_iterator(b.second));
+	}
+
+	// binary search of the stored list, then the recent edges
+	bool has_edge(std::size_t u, std::size_t v) const {
+		if (out_degree_stored(v) < out_degree_stored(u))
+			std::swap(u, v);
+		std::pair<const uint32_t*, const uint32_t*> a = stored_neighbours(u);
+		return std::binary_search(a.first, a.second, (uint32_t) v) || recent_edges.has_edge(u, v);
+	}
+
+	// sorts a search level in file order and has the pages of its lists read ahead
+	void schedule(std::vector<std::size_t>& frontier) const {
+		if (frontier.size() > 1)
+			std::sort(frontier.begin(), frontier.end());
+		if (frontier.size() < readahead_level)
+			return;
+		uint64_t first_page = 0, last_page = 0;
+		bool open_run = false;
+		for (std::size_t indx = 0; indx < frontier.size(); indx++) {
+			std::size_t v = frontier[indx];
+			if (v >= stored_vertices() || offsets[v] == offsets[v + 1])
+				continue;
+			uint64_t first = (list_start + offsets[v] * sizeof(uint32_t)) / page;
+			uint64_t last = (list_start + offsets[v + 1] * sizeof(uint32_t) - 1) / page;
+			if (open_run && first <= last_page + readahead_gap) {
+				last_page = std::max(last_page, last);
+				continue;
+			}
+			if (open_run)
+				advise(first_page, last_page);
+			first_page = first;
+			last_page = last;
+			open_run = true;
+		}
+		if (open_run)
+			advise(first_page, last_page);
+	}
+
+	std::size_t stored_vertices() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+	// the user id of a stored vertex, as given when the file was written
+	int32_t label(std::size_t v) const { return labels[v]; }
+
+	std::size_t out_degree_stored(std::size_t v) const {
+		return v < stored_vertices() ? offsets[v + 1] - offsets[v] : 0;
+	}
+	std::size_t degree(std::size_t v) const { return out_degree_stored(v) + recent_edges.degree(v); }
+	std::size_t vertex_count() const { return recent_edges.vertex_count(); }
+	std::size_t edges() const { return (stored_vertices() ? offsets.back() / 2 : 0) + recent_edges.edges(); }
+
+	unsigned long read_runs() const { return runs; }
+	unsigned long read_pages() const { return pages; }
+	std::size_t file_bytes() const { return mapping_size; }
+	std::size_t memory() const { return offsets.capacity() * sizeof(uint64_t); }
+};
+
+namespace boost {
+template <>
+struct graph_traits<disk_graph> {
+	typedef disk_graph::vertex_descriptor vertex_descriptor;
+	typedef disk_graph::adjacency_iterator adjacency_iterator;
+	typedef std::size_t vertices_size_type;
+	typedef std::size_t degree_size_type;
+};
+}
+
+inline std::size_t num_vertices(const disk_graph& g) { return g.vertex_count(); }
+inline std::size_t out_degree(std::size_t v, const disk_graph& g) { return g.degree(v); }
+inline std::pair<disk_graph::adjacency_iterator, disk_graph::adjacency_iterator>
+adjacent_vertices(std::size_t v, const disk_graph& g) { return g.neighbours(v); }
+inline void schedule_frontier(std::vector<std::size_t>& frontier, const disk_graph& g) { g.schedule(frontier); }
+
+#endif /* DISK_GRAPH_H_ */
@@ -0,0 +1,470 @@
+/*
+ * fraud-alert-bench.cpp
+ *
+ * Benchmarks of the search kernels used by fraud-alert-bfs. The payment
+ * network is built from a batch file and the same random payments are
+ * scored by every variant, which reports the time per search and the
+ * hardware counters (memory stall cycles in particular) it caused; the
+ * interleaved variants keep 8 to 31 searches in flight on one thread. The
+ * parallel phases are then timed on pools of 1 to N threads. Last, the scorer
+ * itself (fraud-alert-bfs, next to the benchmark unless --scorer is given) is
+ * run in service mode under an open loop load, and every overload policy is
+ * checked against the behaviour it promises: the benchmark fails if one is not.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "adjacency.h"
+#include "admission.h"
+#include "bounded_bfs.h"
+#include "hop_summaries.h"
+#include "interleaved_bfs.h"
+#include "landmarks.h"
+#include "latency_histogram.h"
+#include "payment.h"
+#include "perf_counters.h"
+#include "thread_pool.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+typedef adaptive_graph Graph;
+typedef pair<size_t, size_t> Query;
+
+const int max_degree = 4;
+
+// builds the payment network of the batch file, one vertex per user (user_ids maps them back)
+bool load_network(const string& path, Graph& g, vector<int>& user_ids) {
+	data_t payment_data;
+	ifstream batch_file(path.c_str());
+	batch_file >> payment_data;
+	if (!batch_file.eof())
+		return false;
+	unordered_map<long, size_t> users;
+	for (size_t indx = 0; indx < payment_data.size(); indx++) {
+		long ids[2] = { payment_data[indx].id1, payment_data[indx].id2 };
+		size_t nodes[2];
+		for (int side = 0; side < 2; side++) {
+			unordered_map<long, size_t>::iterator it = users.find(ids[side]);
+			if (it != users.end())
+				nodes[side] = it->second;
+			else {
+				nodes[side] = users[ids[side]] = g.add_vertex();
+				user_ids.push_back(ids[side]);
+			}
+		}
+		if (nodes[0] != nodes[1] && !g.has_edge(nodes[0], nodes[1]))
+			g.add_edge(nodes[0], nodes[1]);
+	}
+	return true;
+}
+
+// random payer and payee pairs, the same for every variant
+vector<Query> random_queries(const Graph& g, size_t count) {
+	mt19937_64 rng(2016);
+	vector<Query> queries(count);
+	for (size_t indx = 0; indx < count; indx++)
+		queries[indx] = Query(rng() % num_vertices(g), rng() % num_vertices(g));
+	return queries;
+}
+
+void print_header(const perf_counters& counters) {
+	cout << left << setw(24) << "variant" << right << setw(12) << "ns/search";
+	for (size_t indx = 0; indx < counters.size(); indx++)
+		cout << setw(24) << counters.name(indx);
+	cout << setw(12) << "checksum" << "\n";
+}
+
+void print_row(const string& variant, double seconds, size_t searches, const perf_counters& counters,
+		unsigned long checksum) {
+	cout << left << setw(24) << variant << right << setw(12) << fixed << setprecision(0)
+			<< seconds * 1e9 / searches;
+	for (size_t indx = 0; indx < counters.size(); indx++) {
+		if (counters.available(indx))
+			cout << setw(24) << setprecision(1) << (double) counters.value(indx) / searches;
+		else
+			cout << setw(24) << "n/a";
+	}
+	cout << setw(12) << checksum << "\n";
+}
+
+// runs every query through the bounded search, with or without prefetching and frontier sorting,
+// giant frontiers are expanded on the pool when there is one
+void bench_bfs(const string& variant, const Graph& g, const vector<Query>& queries, bool prefetching, bool sorting,
+		thread_pool* pool, perf_counters& counters) {
+	bounded_bfs search;
+	search.set_prefetching(prefetching);
+	search.set_frontier_sorting(sorting);
+	search.set_pool(pool);
+	unsigned long checksum = 0;
+	for (size_t indx = 0; indx < queries.size() / 10; indx++) // warms the caches and the visited stamps
+		checksum += search.distance(g, queries[indx].first, queries[indx].second, max_degree);
+	checksum = 0;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	counters.start();
+	for (size_t indx = 0; indx < queries.size(); indx++)
+		checksum += search.distance(g, queries[indx].first, queries[indx].second, max_degree);
+	counters.stop();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	print_row(variant, seconds, queries.size(), counters, checksum);
+}
+
+// runs the queries through the interleaved searches, a window of payments at a time
+void bench_interleaved(const string& variant, const Graph& g, const vector<Query>& queries, unsigned in_flight,
+		perf_counters& counters) {
+	const size_t window = 256;
+	interleaved_bfs search(in_flight);
+	vector<Query> batch;
+	vector<size_t> users; // the endpoints of the window, as the scorer marks them
+	unsigned long checksum = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	counters.start();
+	for (size_t first = 0; first < queries.size(); first += window) {
+		batch.assign(queries.begin() + first, queries.begin() + min(queries.size(), first + window));
+		users.clear();
+		for (size_t indx = 0; indx < batch.size(); indx++) {
+			users.push_back(batch[indx].first);
+			users.push_back(batch[indx].second);
+		}
+		search.prepare(g, batch, users, max_degree);
+		for (size_t indx = 0; indx < batch.size(); indx++)
+			checksum += search.searched_distance(indx);
+	}
+	counters.stop();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	print_row(variant, seconds, queries.size(), counters, checksum);
+}
+
+// time of one run of a parallel phase on the given pool
+typedef double (*phase_t)(const Graph& g, const vector<Query>& queries, thread_pool& pool);
+
+double seconds_since(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+double phase_signatures(const Graph& g, const vector<Query>& queries, thread_pool& pool) {
+	hop_summaries summaries(256);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	summaries.build(g, pool);
+	return seconds_since(start);
+}
+
+double phase_landmarks(const Graph& g, const vector<Query>& queries, thread_pool& pool) {
+	landmark_index landmarks;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	landmarks.build(g, 16, pool);
+	return seconds_since(start);
+}
+
+// independent payments scored concurrently, every worker with its own search state
+double phase_scoring(const Graph& g, const vector<Query>& queries, thread_pool& pool) {
+	vector<bounded_bfs> searches(pool.size());
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	pool.parallel_for(0, queries.size(), 16, [&](size_t first, size_t last, unsigned worker) {
+		for (size_t indx = first; indx < last; indx++)
+			searches[worker].distance(g, queries[indx].first, queries[indx].second, max_degree);
+	});
+	return seconds_since(start);
+}
+
+// runs every phase on pools of 1, 2, 4 ... max_threads threads
+void bench_scaling(const Graph& g, const vector<Query>& queries, unsigned max_threads, bool pinned) {
+	const char* names[] = { "2-hop signatures", "16 landmarks", "batch scoring" };
+	phase_t phases[] = { phase_signatures, phase_landmarks, phase_scoring };
+	vector<unsigned> sizes;
+	for (unsigned threads = 1; threads < max_threads; threads *= 2)
+		sizes.push_back(threads);
+	sizes.push_back(max_threads);
+
+	cout << "\nScaling of the parallel phases" << (pinned ? " (pinned threads)" : "") << "\n";
+	cout << left << setw(24) << "phase" << right << setw(10) << "threads" << setw(12) << "seconds"
+			<< setw(10) << "speedup" << setw(12) << "efficiency" << "\n";
+	for (unsigned phase = 0; phase < 3; phase++) {
+		double single = 0;
+		for (size_t indx = 0; indx < sizes.size(); indx++) {
+			thread_pool pool(sizes[indx], pinned);
+			double seconds = phases[phase](g, queries, pool);
+			if (indx == 0)
+				single = seconds;
+			cout << left << setw(24) << names[phase] << right << setw(10) << sizes[indx] << setw(12)
+					<< setprecision(4) << seconds << setw(10) << setprecision(2) << single / seconds
+					<< setw(11) << setprecision(0) << 100 * single / seconds / sizes[indx] << "%\n";
+		}
+	}
+}
+
+// the scorer in service mode, driven the way paymo-loadgen drives it: the payments are sent
+// into its stream FIFO on an open loop timeline (payment i is due at start + i / rate) and its
+// verdicts read back from its output1 FIFO, a latency running from the intended send time
+struct service_run {
+	size_t verdicts;
+	size_t rejected_lines; // "Rejected" lines of output1
+	unsigned long scored[3]; // by scoring mode, as the scorer reports them
+	double sojourn_p99; // microseconds from admission to verdict, as the scorer reports it
+	latency_histogram latencies;
+	double seconds; // from the first send to the last verdict
+};
+
+const size_t service_queue = 4096; // capacity of the scorer's ingress queue
+const unsigned long slo_floor = 25000; // microseconds, keeps the objective above scheduling delays
+
+bool write_all(int fd, const string& text) {
+	for (size_t done = 0; done < text.size();) {
+		ssize_t written = write(fd, text.data() + done, text.size() - done);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+		done += written;
+	}
+	return true;
+}
+
+// the stream FIFO opens for writing once the scorer reads it (after building the network),
+// the open is retried until then unless the scorer exits first
+int open_stream_fifo(const string& path, pid_t scorer) {
+	for (;;) {
+		int fd = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+		if (fd >= 0) {
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+			return fd;
+		}
+		if (errno != ENXIO || waitpid(scorer, 0, WNOHANG) != 0)
+			return -1;
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+}
+
+// sends count payments at rate per second to a started scorer and reads its verdicts
+bool drive_service(pid_t scorer, const string& stream_path, const string& verdict_path, const vector<string>& records,
+		size_t count, double rate, service_run& run) {
+	int stream = open_stream_fifo(stream_path, scorer);
+	if (stream < 0)
+		return false;
+	if (!write_all(stream, "time, id1, id2, amount, message\n")) {
+		close(stream);
+		return false;
+	}
+	ifstream verdicts(verdict_path.c_str());
+
+	// the sender publishes how many payments it is writing, before a fast scorer can answer
+	vector<chrono::steady_clock::time_point> intended(count);
+	atomic<size_t> sent(0);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	thread sender([&] {
+		for (size_t indx = 0; indx < count; indx++) {
+			intended[indx] = start + chrono::duration_cast<chrono::steady_clock::duration>(
+					chrono::duration<double>(indx / rate));
+			this_thread::sleep_until(intended[indx]);
+			sent.store(indx + 1, memory_order_release);
+			if (!write_all(stream, records[indx % records.size()])) {
+				sent.store(indx, memory_order_release);
+				break;
+			}
+		}
+		close(stream); // end of the stream, the scorer drains and exits
+	});
+
+	string line;
+	while (getline(verdicts, line)) {
+		if (run.verdicts < sent.load(memory_order_acquire))
+			run.latencies.record(chrono::steady_clock::now() - intended[run.verdicts]);
+		run.rejected_lines += line == "Rejected";
+		run.verdicts++;
+	}
+	run.seconds = seconds_since(start);
+	sender.join();
+	return run.verdicts == count && sent.load() == count;
+}
+
+// runs the scorer on the batch file and a stream of count payments offered at rate per
+// second, false if it could not be run or did not answer every payment
+bool run_service(const string& scorer, const string& batch_path, const vector<string>& records, size_t count,
+		double rate, overload_policy policy, unsigned long slo, service_run& run) {
+	const char* names[] = { "wait", "shed", "reject", "priority" };
+	run.verdicts = run.rejected_lines = 0;
+	run.scored[score_full] = run.scored[score_cheap] = run.scored[score_rejected] = 0;
+	run.sojourn_p99 = 0;
+	run.latencies.clear();
+	char dir_template[] = "/tmp/paymo-bench-XXXXXX";
+	if (!mkdtemp(dir_template))
+		return false;
+	string dir = dir_template;
+	string stream_path = dir + "/stream.fifo", verdict_path = dir + "/output1.fifo", log_path = dir + "/scorer.log";
+	vector<string> args = { scorer, "--service-queue=" + to_string(service_queue), "--slo=" + to_string(slo),
+		string("--overload=") + names[policy], batch_path, stream_path, verdict_path, dir + "/output2.txt",
+		dir + "/output3.txt" };
+	// the arguments are prepared before the fork, the child only opens its log and execs
+	vector<char*> argv;
+	for (size_t indx = 0; indx < args.size(); indx++)
+		argv.push_back(const_cast<char*>(args[indx].c_str()));
+	argv.push_back(0);
+
+	pid_t child = -1;
+	if (mkfifo(stream_path.c_str(), 0600) == 0 && mkfifo(verdict_path.c_str(), 0600) == 0)
+		child = fork();
+	if (child == 0) {
+		int log = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (log >= 0)
+			dup2(log, STDOUT_FILENO);
+		execv(argv[0], &argv[0]);
+		_exit(127);
+	}
+	bool answered = child > 0 && drive_service(child, stream_path, verdict_path, records, count, rate, run);
+	int status = -1;
+	if (child > 0 && waitpid(child, &status, 0) != child)
+		status = -1;
+
+	// the scorer's own report: payments by scoring mode and sojourn times
+	bool reported = false;
+	ifstream log(log_path.c_str());
+	string line;
+	while (getline(log, line)) {
+		reported = reported || sscanf(line.c_str(), "Service mode: %lu payments scored in full, %lu from the cheap "
+				"signals, %lu rejected", &run.scored[score_full], &run.scored[score_cheap], &run.scored[score_rejected]) == 3;
+		sscanf(line.c_str(), "Sojourn time (us): p50 %*f, p99 %lf", &run.sojourn_p99);
+	}
+	string files[] = { stream_path, verdict_path, log_path, dir + "/output2.txt", dir + "/output3.txt" };
+	for (unsigned indx = 0; indx < 5; indx++)
+		unlink(files[indx].c_str());
+	rmdir(dir.c_str());
+	return answered && reported && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// every overload policy of the scorer, the offered load going from half to four times its
+// measured capacity. Checked on every point: one verdict per payment and a Rejected line per
+// rejected payment; at half the capacity no payment rejected; under shed and reject a 99th
+// percentile sojourn within twice the objective, the overdue payments being drained instead
+// of queueing up. Returns false if a check failed.
+bool bench_overload(const string& scorer, const string& batch_path, const vector<int>& user_ids,
+		const vector<Query>& queries) {
+	// the stream: the random pairs of the workload, amounts exponentially distributed around 50
+	vector<string> records;
+	mt19937_64 rng(2016);
+	exponential_distribution<double> amounts(1.0 / 50);
+	for (size_t indx = 0; indx < queries.size(); indx++) {
+		char record[128];
+		snprintf(record, sizeof(record), "2016-11-02 09:49:29, %d, %d, %.2f, bench\n",
+				user_ids[queries[indx].first], user_ids[queries[indx].second], amounts(rng));
+		records.push_back(record);
+	}
+
+	// the capacity: every payment due at once, scored as fast as the scorer goes
+	service_run run;
+	size_t probes = min<size_t>(records.size(), 5000);
+	if (records.empty() || !run_service(scorer, batch_path, records, probes, 1e12, overload_wait, slo_floor, run)) {
+		cout << "\nError while running the scorer " << scorer << " in service mode. Aborting.\n";
+		return false;
+	}
+	double capacity = run.verdicts / run.seconds;
+	unsigned long slo = max(slo_floor, (unsigned long) (20 * 1e6 / capacity));
+
+	cout << "\nOverload policies, capacity " << fixed << setprecision(0) << capacity << " payments/s, objective "
+			<< setprecision(2) << slo / 1e3 << " ms\n";
+	cout << left << setw(12) << "policy" << right << setw(12) << "offered/s" << setw(12) << "full/s"
+			<< setw(12) << "shed/s" << setw(12) << "rejected/s" << setw(12) << "p50 ms" << setw(12) << "p99 ms"
+			<< setw(14) << "sojourn p99" << "\n";
+	const char* names[] = { "wait", "shed", "reject", "priority" };
+	overload_policy policies[] = { overload_wait, overload_shed, overload_reject, overload_priority };
+	bool passed = true;
+	for (unsigned policy = 0; policy < 4; policy++) {
+		for (double load = 0.5; load <= 4; load *= 2) {
+			double rate = load * capacity;
+			size_t count = max<size_t>(1, (size_t) rate); // a second of offered load
+			bool answered = run_service(scorer, batch_path, records, count, rate, policies[policy], slo, run);
+			cout << left << setw(12) << names[policy] << right << setw(12) << setprecision(0) << rate
+					<< setw(12) << run.scored[score_full] / run.seconds << setw(12) << run.scored[score_cheap] / run.seconds
+					<< setw(12) << run.scored[score_rejected] / run.seconds << setw(12) << setprecision(2)
+					<< run.latencies.percentile(0.5) / 1e6 << setw(12) << run.latencies.percentile(0.99) / 1e6
+					<< setw(14) << run.sojourn_p99 / 1e3 << "\n";
+			vector<string> failures;
+			if (!answered)
+				failures.push_back("the scorer did not answer every payment");
+			if (run.rejected_lines != run.scored[score_rejected])
+				failures.push_back("Rejected lines do not match the rejected payments");
+			if (load < 1 && run.rejected_lines > 0)
+				failures.push_back("payments rejected below the capacity");
+			if ((policies[policy] == overload_shed || policies[policy] == overload_reject) && run.sojourn_p99 > 2 * slo)
+				failures.push_back("99th percentile sojourn beyond twice the objective");
+			for (size_t indx = 0; indx < failures.size(); indx++)
+				cout << "CHECK FAILED (" << names[policy] << " at " << setprecision(1) << load << "x): "
+						<< failures[indx] << "\n";
+			passed = passed && failures.empty();
+		}
+	}
+	return passed;
+}
+
+int main(int argc, char* argv[]) {
+	string batch_path = "paymo_input/batch_payment.txt";
+	size_t queries = 20000;
+	unsigned max_threads = max(1u, thread::hardware_concurrency());
+	bool pinned = false;
+	string scorer = string(argv[0]).substr(0, string(argv[0]).find_last_of('/') + 1) + "fraud-alert-bfs";
+	for (int indx = 1; indx < argc; indx++) {
+		string arg = argv[indx];
+		if (arg.compare(0, 10, "--queries=") == 0)
+			queries = strtoul(arg.c_str() + 10, 0, 10);
+		else if (arg.compare(0, 14, "--max-threads=") == 0 && atoi(arg.c_str() + 14) > 0)
+			max_threads = atoi(arg.c_str() + 14);
+		else if (arg == "--pin-threads")
+			pinned = true;
+		else if (arg.compare(0, 9, "--scorer=") == 0)
+			scorer = arg.substr(9);
+		else if (arg.compare(0, 2, "--") != 0)
+			batch_path = arg;
+		else {
+			cout << "Usage: " << argv[0] << " [--queries=COUNT] [--max-threads=COUNT] [--pin-threads] [--scorer=PATH]"
+					<< " [batch_payment]\n";
+			return 1;
+		}
+	}
+
+	signal(SIGPIPE, SIG_IGN); // a scorer going away shows up as a failed write
+
+	Graph g;
+	vector<int> user_ids;
+	if (!load_network(batch_path, g, user_ids) || num_vertices(g) == 0) {
+		cout << "Error while reading the *batch* payment file. Aborting.\n";
+		return 1;
+	}
+	cout << "The payment network has " << num_vertices(g) << " users and " << g.edges() << " friendships ("
+			<< g.memory() / 1024 << " KB).\n";
+
+	vector<Query> workload = random_queries(g, queries);
+	perf_counters counters;
+	cout << "\nBounded search up to the " << max_degree << "th degree, " << queries << " random payments\n";
+	cout << "(per search)\n";
+	print_header(counters);
+	bench_bfs("bfs plain", g, workload, false, false, 0, counters);
+	bench_bfs("bfs prefetching", g, workload, true, false, 0, counters);
+	bench_bfs("bfs prefetch+sorted", g, workload, true, true, 0, counters);
+	for (unsigned in_flight = 8; in_flight <= 32; in_flight *= 2)
+		bench_interleaved("bfs interleaved x" + to_string(min(max_lanes, in_flight)), g, workload, in_flight, counters);
+	thread_pool pool(max_threads, pinned);
+	bench_bfs("bfs parallel levels", g, workload, true, false, &pool, counters);
+
+	bench_scaling(g, workload, max_threads, pinned);
+	return bench_overload(scorer, batch_path, user_ids, workload) ? 0 : 1;
+}
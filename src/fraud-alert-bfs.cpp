@@ -19,36 +19,46 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <algorithm>
+#include <chrono>
 #include <climits>
+#include <cstdlib>
+#include <memory>
+#include <thread>
 
 #include <boost/config.hpp>
 #include <boost/graph/graph_traits.hpp>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/property_map/property_map.hpp>
-#include <boost/graph/breadth_first_search.hpp>
+
+#include "adjacency.h"
+#include "admission.h"
+#include "ball_cache.h"
+#include "batch_loader.h"
+#include "binary_payments.h"
+#include "bloom_filter.h"
+#include "bounded_bfs.h"
+#include "components.h"
+#include "dedup_filter.h"
+#include "disk_graph.h"
+#include "hop_summaries.h"
+#include "hubs.h"
+#include "interleaved_bfs.h"
+#include "landmarks.h"
+#include "memory_budget.h"
+#include "payment.h"
+#include "quarantine.h"
+#include "reorder_buffer.h"
+#include "source_groups.h"
+#include "stream_merge.h"
+#include "thread_pool.h"
+#include "verdict_file.h"
 
 using namespace std;
 using namespace boost;
 
-// payment struct is modeled after PayMo payment records
-// a record consists of five fields separated by commas:
-// time, id1, id2, amount, message
-// 2016-11-02 09:49:29, 52575, 1120, 25.32, Spam
-typedef struct {
-	std::string time; // the timestamp is being stored as a string.
-	int id1; // warning: casting to integer without input validation
-	int id2; // warning: casting to integer without input validation
-	std::string amount; // since we are not using amount we keep it as a string
-	std::string message;
-} payment_t;
-
-typedef vector<payment_t> data_t;
-
-// Graph Definitions
-typedef adjacency_list<vecS, vecS, undirectedS> Graph;
+// Graph Definitions: every user keeps the neighbour set representation that suits its degree
+typedef adaptive_graph Graph;
 typedef graph_traits<Graph>::vertex_descriptor Vertex;
 typedef graph_traits<Graph>::vertices_size_type Size;
-typedef graph_traits<Graph>::edge_descriptor Edge;
 
 typedef int UID;
 typedef Vertex Node;
@@ -57,6 +67,10 @@ typedef std::map<UID, Node> UserMap; //key->UID; value-> Node
 typedef std::map<Node, UID> NodeMap; //key->Node; value-> UID
 typedef std::pair<Node, Node> Connection;
 
+// the batch network mapped from a CSR file, the graph then only keeps the edges added
+// by the stream (optional, see --disk-graph)
+std::unique_ptr<disk_graph> disk;
+
 // users and nodes have a one-to-one association
 UserMap users;
 NodeMap nodes;
@@ -64,6 +78,45 @@ NodeMap nodes;
 // mantain a set of all one-to-one friendships (using map)
 map<long, bool> friends;
 
+// bloom filter over the packed edge keys, rejects most direct lookups of new pairs
+// before they reach the friends map (optional, see --bloom-fpr)
+std::unique_ptr<blocked_bloom_filter> edge_filter;
+unsigned long rejected_lookups = 0;
+
+// 2-hop neighbourhood signatures, prove most far apart pairs to be beyond the
+// 4th degree without a search (optional, see --summary-bits)
+std::unique_ptr<hop_summaries> summaries;
+unsigned long summary_rejections = 0;
+
+// landmark distances, their lower bounds reject far apart pairs and prune the
+// bounded search (optional, see --landmarks)
+std::unique_ptr<landmark_index> landmarks;
+unsigned long landmark_rejections = 0;
+
+// very high degree users, the bounded search resolves paths through them with
+// bit tests instead of expanding them (optional, see --hub-degree)
+std::unique_ptr<hub_index> hubs;
+unsigned long hub_searches = 0;
+
+// distance balls of the payers sending bursts of payments (optional, see --ball-cache)
+std::unique_ptr<ball_cache> balls;
+
+// one traversal per payer with several payments in a window (optional, see --group-window)
+std::unique_ptr<source_groups> groups;
+
+// the searches of a window run interleaved on one thread (optional, see --interleave)
+std::unique_ptr<interleaved_bfs> interleaved;
+const unsigned interleave_window = 8; // payments per search in flight read at a time, unless grouped
+
+// connected components, the cheap signal of the service mode under overload (see --service-queue)
+std::unique_ptr<union_find> components;
+const int rejected_payment = -1; // returned by score_payment for a payment rejected under overload
+const int malformed_payment = -2; // returned by score_payment for a quarantined line (see --quarantine)
+
+// accounted memory of the large structures, cold adjacency is paged out beyond it (see --memory-budget)
+std::unique_ptr<memory_budget> budget;
+const unsigned long budget_interval = 1024; // payments between two checks of the budget
+
 // attempting to minimize the time it takes to test if a connection exists
 // using the perfect hash function posted by nawfal in stackoverflow
 // REF: http://stackoverflow.com/questions/919612/mapping-two-integers-to-one-in-a-unique-and-deterministic-way
@@ -96,22 +149,87 @@ Node add_user(UID uid, Graph& g) {
 	if (it != users.end()) {
 		node = it->second;
 	} else {
-		node = add_vertex(g);
+		node = g.add_vertex();
 		users.insert(std::make_pair(uid, node));
 		nodes.insert(std::make_pair(node, uid));
+		if (summaries)
+			summaries->add_vertex(node);
+		if (landmarks)
+			landmarks->add_vertex(node);
+		if (hubs)
+			hubs->add_vertex(node);
+		if (components)
+			components->add_vertex();
 	}
 	return node;
 }
 
+// (re)builds the bloom filter in front of the direct friendship lookup, sized with
+// room for the network to double before the filter has to be rebuilt again
+template <typename Network>
+void build_edge_filter(const Network& g, double fpr) {
+	std::size_t capacity = 2 * g.edges();
+	if (edge_filter)
+		edge_filter->reset(capacity);
+	else
+		edge_filter.reset(new blocked_bloom_filter(capacity, fpr));
+	typename graph_traits<Network>::adjacency_iterator vi, vi_end;
+	for (Vertex v = 0; v < num_vertices(g); v++)
+		for (tie(vi, vi_end) = adjacent_vertices(v, g); vi != vi_end; ++vi)
+			if (v < *vi) // every edge once, smaller node first
+				edge_filter->insert(pack_pair(v, *vi));
+}
+
+// tests whether the network already has an edge between both nodes
+bool has_connection(Connection connection, const Graph& g) {
+	return disk ? disk->has_edge(connection.first, connection.second) : g.has_edge(connection.first, connection.second);
+}
+
+// registers an edge just added to the paymo graph with the friendship set and every index
+void register_edge(Vertex v0, Vertex v1, Graph& g) {
+	friends[perfect_hash(v0, v1)] = true;
+	if (summaries)
+		summaries->add_edge(v0, v1, g);
+	if (landmarks)
+		landmarks->add_edge(v0, v1, g);
+	if (hubs)
+		hubs->add_edge(v0, v1, g);
+	if (balls)
+		balls->add_edge(v0, v1, g);
+	if (groups)
+		groups->edge_added(v0, v1);
+	if (interleaved)
+		interleaved->edge_added(v0, v1);
+	if (components)
+		components->unite(v0, v1);
+	if (edge_filter) {
+		edge_filter->insert(pack_pair(v0, v1));
+		if (edge_filter->saturated() && disk)
+			build_edge_filter(*disk, edge_filter->fpr());
+		else if (edge_filter->saturated())
+			build_edge_filter(g, edge_filter->fpr());
+	}
+}
+
 // this method updates the payment graph creating an edge between the nodes in case there is none
 void update_network(Connection connection, Graph& g) {
-	Vertex v0 = connection.first;
-	Vertex v1 = connection.second;
 	// the payment network is updated only if there is no prior transactions between users
-	if (!edge(v0, v1, g).second) { // according to our convention v0 is always smaller than v1
-		add_edge(v0, v1, g); // adding new edge to paymo graph
-		friends[perfect_hash(v0, v1)] = true;
+	if (!has_connection(connection, g)) { // according to our convention v0 is always smaller than v1
+		g.add_edge(connection.first, connection.second); // adding new edge to paymo graph
+		register_edge(connection.first, connection.second, g);
+	}
+}
+
+// tests whether both nodes are directly connected, the bloom filter answers most misses
+bool direct_friends(Connection connection) {
+	if (edge_filter && !edge_filter->may_contain(pack_pair(connection.first, connection.second))) {
+		rejected_lookups++;
+		return false;
 	}
+	// the friendship set only holds the stream's edges in semi-external mode
+	if (disk)
+		return disk->has_edge(connection.first, connection.second);
+	return friends[perfect_hash(connection.first, connection.second)];
 }
 
 // this method process all payments, registering PayMo users and existing payment connections
@@ -127,200 +245,1017 @@ void build_paymo_network(data_t& payment_data, Graph& g) {
 	}
 }
 
-// overloading input stream operator to read a single PayMo batch_payment record
-istream& operator >>(istream& is, payment_t& record) {
-
-	// the entire payment record is first read into a string and then parsed out
-	// NOTE: each payment record occupies a line and values are separated by comma
-	string line;
-	getline(is, line);
-
-	// separating the comma delimited values out of the line
-	stringstream ss(line);
-	string id1_field, id2_field;
-	getline(ss, record.time, ',');
-	getline(ss, id1_field, ',');
-	getline(ss, id2_field, ',');
-	getline(ss, record.amount, ',');
-	getline(ss, record.message);
-
-	stringstream id1fss(id1_field);
-	stringstream id2fss(id2_field);
-	id1fss >> record.id1;
-	id2fss >> record.id2;
-
-	return is;
+// appends the pairs of a batch to the network without rebuilding it: the pairs are
+// deduplicated (within the batch, then against the network), the new edges merged into
+// the neighbour sets in bulk, and the indexes updated edge by edge. Returns the edges added.
+std::size_t append_pairs(std::vector<Connection>& pairs, Graph& g) {
+	std::sort(pairs.begin(), pairs.end());
+	pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+	std::size_t kept = 0;
+	for (std::size_t indx = 0; indx < pairs.size(); indx++)
+		if (!has_connection(pairs[indx], g))
+			pairs[kept++] = pairs[indx];
+	pairs.resize(kept);
+	g.add_edges(pairs);
+	for (std::size_t indx = 0; indx < pairs.size(); indx++)
+		register_edge(pairs[indx].first, pairs[indx].second, g);
+	return pairs.size();
 }
 
-// overloading the input stream operator to read a list of PayMo payment records
-istream& operator >>(istream& is, data_t& data) {
-	// since we reuse our payment database, both for the batch_payment and stream_payment
-	// we clear the database every time we read a new payment file.
-	data.clear();
+// appends a batch of payments read from a CSV file
+std::size_t append_batch(const data_t& payment_data, Graph& g) {
+	std::vector<Connection> pairs;
+	pairs.reserve(payment_data.size());
+	for (std::size_t indx = 0; indx < payment_data.size(); indx++)
+		pairs.push_back(create_connection(add_user(payment_data[indx].id1, g), add_user(payment_data[indx].id2, g)));
+	return append_pairs(pairs, g);
+}
 
-	// removing the first line of the payment CSV file (PayMo header)
-	string header_line;
-	getline(is, header_line);
+// the same for binary payment records, the ids are taken straight from the mapped file
+std::size_t append_batch(const binary_payment_file& payments, Graph& g) {
+	std::vector<Connection> pairs;
+	pairs.reserve(payments.size());
+	for (std::size_t indx = 0; indx < payments.size(); indx++)
+		pairs.push_back(create_connection(add_user(payments.id1(indx), g), add_user(payments.id2(indx), g)));
+	return append_pairs(pairs, g);
+}
 
-	// Reading records from file and appending them to the payment database
-	payment_t record;
-	while (is >> record) {
-		data.push_back(record);
+// the same for binary payment records, the ids are taken straight from the mapped file
+void build_paymo_network(const binary_payment_file& payments, Graph& g) {
+	for (std::size_t indx = 0; indx < payments.size(); indx++) {
+		Node node1 = add_user(payments.id1(indx), g);
+		Node node2 = add_user(payments.id2(indx), g);
+		update_network(create_connection(node1, node2), g);
 	}
+}
 
-	return is;
+// the same, in semi-external mode: the graph only registers the users, the edges are
+// handed to the CSR file writer (repeated ones are dropped when the file is merged)
+void build_paymo_network(const data_t& payment_data, Graph& g, csr_writer& csr) {
+	for (std::size_t indx = 0; indx < payment_data.size(); indx++) {
+		Node node1 = add_user(payment_data[indx].id1, g);
+		Node node2 = add_user(payment_data[indx].id2, g);
+		csr.add_edge(node1, node2);
+	}
+}
+
+void build_paymo_network(const binary_payment_file& payments, Graph& g, csr_writer& csr) {
+	for (std::size_t indx = 0; indx < payments.size(); indx++) {
+		Node node1 = add_user(payments.id1(indx), g);
+		Node node2 = add_user(payments.id2(indx), g);
+		csr.add_edge(node1, node2);
+	}
 }
 
 // Visualization of paymo network using graphviz (*.dot file)
 // NOTE: the build directory must have a directory called figs
-void build_visualization(Graph g) {
+template <typename Network>
+void build_visualization(const Network& g) {
 	std::ofstream fout("figs/paymo-network.dot");
 	fout << "digraph A {\n" << "  rankdir=LR\n" << "size=\"5,3\"\n"
 			<< "ratio=\"fill\"\n" << "edge[style=\"bold\"]\n"
 			<< "node[shape=\"oval\"]\n";
 
-	graph_traits<Graph>::edge_iterator ei, ei_end;
-	for (tie(ei, ei_end) = edges(g); ei != ei_end; ++ei)
-		fout << nodes[source(*ei, g)] << " -> " << nodes[target(*ei, g)]
-				<< "[label=1]\n";
+	typename graph_traits<Network>::adjacency_iterator vi, vi_end;
+	for (Vertex v = 0; v < num_vertices(g); v++)
+		for (tie(vi, vi_end) = adjacent_vertices(v, g); vi != vi_end; ++vi)
+			if (v < *vi)
+				fout << nodes[v] << " -> " << nodes[*vi] << "[label=1]\n";
 
 	fout << "}\n";
 }
 
-/* NOTE: to optimize performance a customized visitor is used
- * halting execution when the target node is found. The halting
- * visitor code was adapted from stackoverflow. The bfs distance
- * visitor was modelled after the Bacon Number example from Boost.
- * REF1: http://stackoverflow.com/questions/32047840/make-boost-dijkstra-algorithm-stop-when-it-reaches-a-destination-node
- * REF2: http://www.boost.org/doc/libs/1_54_0/libs/graph/example/kevin-bacon.cpp
- */
+// the features only tell friends up to the 4th degree apart, so the search never
+// has to look further: any pair further apart is reported as beyond_network
+const int max_degree = 4;
+const int beyond_network = max_degree + 1;
 
-// Throwing an exception is the preferred mechanism used to stop search in boost
-#define stop_search_exception 404
-
-// Visitor that throw an exception whenever it finds the target node
-template < typename DistanceMap >
-class bfs_distance_visitor :public default_bfs_visitor{
-private:
-	DistanceMap d;
-	Vertex stop_vertex;
-public:
-	bfs_distance_visitor(DistanceMap d, Vertex stop_vertex) :
-		d(d), stop_vertex(stop_vertex) {};
-
-    template <typename Edge, typename Graph>
-    void tree_edge(Edge e, const Graph& g) const
-    {
-      Vertex u = source(e, g);
-      Vertex v = target(e, g);
-      d[v] = d[u] + 1;
-      if (v == stop_vertex)
-    	  throw (stop_search_exception);
-    }
+// the search state is reused by every query (no per query initialisation over the graph)
+bounded_bfs degree_search;
+
+// prunes the vertices the landmarks prove too far from the target to reach it in time
+struct landmark_pruning {
+	const landmark_index& index;
+	Vertex target;
+	bool operator()(std::size_t vertex, int distance) const {
+		return index.lower_bound(vertex, target, max_degree) > max_degree - distance;
+	}
 };
 
-// record_bfs_distance is a convenience wrapper used to access the bfs_distance_visitor
-template < typename DistanceMap >
-bfs_distance_visitor<DistanceMap>
-record_bfs_distance(DistanceMap d, Vertex stop_vertex){
-	return bfs_distance_visitor< DistanceMap > (d, stop_vertex);
+// the landmark distances are only read during a search
+template <>
+struct concurrent_prune<landmark_pruning> {
+	static const bool value = true;
+};
+
+// work stealing pool building the indexes and expanding the giant frontiers of the
+// bounded search (see --threads)
+std::unique_ptr<thread_pool> workers;
+
+// what an undetermined friendship degree (a search out of budget) is taken for
+enum undetermined_policy {
+	undetermined_unverified, // the most distant degree not ruled out: alerts unless disproven
+	undetermined_trusted // the closest degree not ruled out: no alert unless proven
+};
+undetermined_policy undetermined = undetermined_unverified;
+unsigned long undetermined_degrees = 0;
+
+// the degree taken for a pair only known to lie between lower and upper
+int undetermined_degree(int lower, int upper, bool& determined) {
+	if (lower >= upper)
+		return upper;
+	determined = false;
+	undetermined_degrees++;
+	return undetermined == undetermined_trusted ? lower : upper;
 }
 
-/* The friendship_degree method runs a breadth_first_search algorithm to determine
+/* The friendship_degree method runs a bounded breadth first search to determine
  * the distance between the start node (conn.first) and the target node (conn.second).
+ * The search is bounded to max_degree, pairs further apart are beyond_network.
+ * With a search budget (see --search-budget) the search may give up, the degree is
+ * then undetermined between the bounds proven so far and the policy picks one of them.
  */
-int friendship_degree(Connection connection, Graph& g) {
+int friendship_degree(Connection connection, Graph& g, bool& determined) {
 
 	// Initializing breadth first search parameters
 	Node start_node = connection.first;
 	Node stop_node = connection.second;
-	Vertex start_vertex = vertex(start_node, g);
-	Vertex stop_vertex = vertex(stop_node, g);
-	std::vector<int> d(num_vertices(g), (std::numeric_limits<int>::max)());
-	d[start_node] = 0; // setting the start_node distance from itself
+	Vertex start_vertex = start_node;
+	Vertex stop_vertex = stop_node;
+
+	// a user paying themselves is at distance 0, whatever the kernels below would find
+	if (start_vertex == stop_vertex)
+		return 0;
+
+	if (disk) {
+		// the batch edges are read from the file: the search also finds the first degrees,
+		// its levels are read ahead in file order
+		unsigned long overruns = degree_search.overrun_count();
+		int distance = degree_search.distance(*disk, start_vertex, stop_vertex, max_degree);
+		if (degree_search.overrun_count() == overruns)
+			return distance;
+		return undetermined_degree(std::max(2, degree_search.proven_distance()), beyond_network, determined);
+	}
+
+	// the second degree is a single intersection of both neighbour sets
+	if (g.has_edge(start_vertex, stop_vertex))
+		return 1;
+	if (g.intersects(start_vertex, stop_vertex))
+		return 2;
+
+	// searched with the rest of the window, unless an edge inserted since may shorten it
+	int distance;
+	if (interleaved && interleaved->answer(g, start_vertex, stop_vertex, distance))
+		return distance;
 
-	try {
-		breadth_first_search(g, start_vertex, visitor(record_bfs_distance(&d[0], stop_vertex)));
-	} catch (int exception) { /* Ignored */ }
+	unsigned long overruns = degree_search.overrun_count();
+	if (hubs) {
+		// the hub search expands the ordinary endpoint, the pruning is aimed at the other one
+		if (hubs->is_hub(start_vertex))
+			std::swap(start_vertex, stop_vertex);
+		hub_searches++;
+		if (landmarks) {
+			landmark_pruning prune = { *landmarks, stop_vertex };
+			distance = hubs->distance(g, degree_search, start_vertex, stop_vertex, max_degree, prune);
+		} else
+			distance = hubs->distance(g, degree_search, start_vertex, stop_vertex, max_degree, no_pruning());
+	} else if (landmarks) {
+		landmark_pruning prune = { *landmarks, stop_vertex };
+		distance = degree_search.distance(g, start_vertex, stop_vertex, max_degree, prune);
+	} else
+		distance = degree_search.distance(g, start_vertex, stop_vertex, max_degree);
+	if (degree_search.overrun_count() == overruns)
+		return distance;
 
-	return d[stop_node];
+	// out of budget: the kernels above proved the 3rd degree at least, the search the level
+	// it gave up on (hubs are never searched under a budget, see parse_arguments)
+	int lower = std::max(3, degree_search.proven_distance());
+	int upper = beyond_network;
+	if (landmarks) {
+		lower = std::max(lower, landmarks->lower_bound(start_vertex, stop_vertex, max_degree));
+		upper = std::min(upper, landmarks->upper_bound(start_vertex, stop_vertex, max_degree));
+	}
+	return undetermined_degree(lower, upper, determined);
 }
 
+// the degree of a payment scored from the cheap signals only (the service is overloaded):
+// beyond the network across components, undetermined within one
+int cheap_degree(Connection connection, bool& determined) {
+	if (connection.first == connection.second)
+		return 0; // a user paying themselves, as friendship_degree has it
+	if (!components->connected(connection.first, connection.second))
+		return beyond_network;
+	return undetermined_degree(2, beyond_network, determined);
+}
 
-int main() {
+// scores a single stream payment: returns the friendship degree between payer and payee
+// (determined is cleared when a search ran out of budget) and registers the payment in the PayMo network,
+// rejected_payment and malformed_payment stand for the payments that are not scored
+int score_payment(const payment_t& payment, Graph& g, bool& determined) {
+	UID uid1 = payment.id1;
+	UID uid2 = payment.id2;
+	Node node1 = add_user(uid1, g);
+	Node node2 = add_user(uid2, g);
+	Connection connection = create_connection(node1, node2);
 
-	// A database will be used to hold our payment records
-	data_t payment_data;
+	int friendship = beyond_network;
+	determined = true;
+
+	if (payment.malformed) {
+		// a line refused by the strict reader, it only keeps the outputs aligned with the stream
+		std::cout << "Malformed payment record" << std::endl;
+		return malformed_payment;
+	}
+	if (payment.scoring == score_rejected) {
+		// the service is overloaded: the payment is neither scored nor added to the network
+		std::cout << "Rejected payment between USER:" << uid1 << " and USER:" << uid2 << std::endl;
+		return rejected_payment;
+	}
+	if (payment.duplicate && has_connection(connection, g)) {
+		// a repeated record: the original payment already connected both users (a retry of
+		// a payment rejected under overload finds no edge and is scored as any other)
+		friendship = 1;
+		std::cout << "Duplicate payment between USER:" << uid1 << " and USER:" << uid2 << std::endl;
+	} else if (direct_friends(connection)) {
+		// if a direct connection exists between both nodes (users) then no alert is needed
+		friendship = 1;
+		std::cout << "Existing friendship between USER:" << uid1 << " and USER:" << uid2 << std::endl;
+	} else if (payment.scoring == score_cheap) {
+		// the payment waited beyond the latency objective: no search
+		friendship = cheap_degree(connection, determined);
+		update_network(connection, g);
+		std::cout << "The friendship degree between USER:" << uid1 << " and USER:" << uid2;
+		if (!determined)
+			std::cout << " is undetermined (overload)" << std::endl;
+		else if (friendship > max_degree)
+			std::cout << " is beyond the network" << std::endl;
+		else
+			std::cout << " is " << friendship << std::endl;
+	} else {
+		bool burst = balls && balls->repeated(node1);
+		if (balls && balls->lookup(node1, node2, friendship)) {
+			// the payer's ball is saved from an earlier payment of the burst
+		} else if (groups && groups->answer(g, node1, node2, friendship)) {
+			// answered by the window traversal of the payer, no edge inserted since changes it
+		} else if (summaries && summaries->far_apart(connection.first, connection.second)) {
+			// the 2-hop balls share no vertex: the users are beyond the 4th degree
+			friendship = beyond_network;
+			summary_rejections++;
+		} else if (landmarks && landmarks->lower_bound(connection.first, connection.second, max_degree) > max_degree) {
+			// the landmark distances prove the users to be beyond the 4th degree
+			friendship = beyond_network;
+			landmark_rejections++;
+		} else if (burst && balls->build(g, degree_search, node1)) {
+			// a payer in a burst: its whole ball is explored once and saved for the next payments
+			balls->lookup(node1, node2, friendship);
+		} else {
+			// for all other cases we will use a bounded breadth first search
+			friendship = friendship_degree(connection, g, determined);
+		}
+		update_network(connection, g); // updating PayMo payment graph
+		std::cout << "The friendship degree between USER:" << uid1 << " and USER:" << uid2;
+		if (!determined)
+			std::cout << " is undetermined within the search budget, taken as "
+					<< (undetermined == undetermined_trusted ? "the closest" : "the most distant")
+					<< " degree not ruled out" << std::endl;
+		else if (friendship > max_degree)
+			std::cout << " is beyond the " << max_degree << "th degree" << std::endl;
+		else
+			std::cout << " is " << friendship << std::endl;
+	}
+	return friendship;
+}
+
+// command line configuration, positional arguments follow the order used by run.sh:
+// fraud-alert-bfs [options] [batch_payment[,batch_payment...] [stream_payment[,stream_payment...] [output1 output2 output3]]]
+// the batch history can be partitioned into files, directories or glob patterns, they are
+// ingested concurrently; several stream feeds (files or FIFOs) can be given as a comma
+// separated list, they are merged by timestamp before scoring.
+typedef struct {
+	std::vector<std::string> batch_paths;
+	std::vector<std::string> stream_paths;
+	std::string output_paths[3];
+	long lateness; // seconds a payment may arrive behind the newest one, negative disables reordering
+	std::string late_events_path; // late payments are logged here instead of being scored
+	long dedup_window; // seconds over which repeated records are suppressed, 0 disables it
+	dedup_policy dedup; // repeated records are either dropped or marked
+	double bloom_fpr; // false positive rate of the edge bloom filter, 0 disables it
+	unsigned summary_bits; // size of the 2-hop neighbourhood signatures, 0 disables them
+	unsigned landmarks; // number of landmark vertices, 0 disables the distance bounds
+	unsigned hub_degree; // users with at least this many friends are hubs, 0 disables them
+	unsigned ball_cache; // saved distance balls of bursting payers, 0 disables them
+	unsigned group_window; // payments grouped by payer before scoring, 0 scores them one by one
+	unsigned interleave; // searches of a window in flight on one thread, 0 searches on demand
+	unsigned long search_budget; // edge visits a search may use, 0 for no limit
+	unsigned long search_deadline; // microseconds a search may use, 0 for no limit
+	bool prefetch; // the search issues the loads of the frontier ahead of its expansion
+	bool frontier_sort; // the search sorts its next frontier in chunks
+	undetermined_policy undetermined; // degree taken when a search runs out of budget
+	std::size_t service_queue; // capacity of the ingress queue of the service mode, 0 disables it
+	unsigned long slo; // latency objective of the service mode (microseconds of queue delay)
+	overload_policy overload; // what happens to the payments waiting beyond the objective
+	double priority_amount; // overdue payments from this amount up are still scored in full
+	std::size_t memory_budget; // MB of accounted memory before cold adjacency is paged out, 0 for no limit
+	std::string disk_graph_path; // CSR file the batch network is written to and searched from
+	bool disk_graph_reuse; // the CSR file of an earlier run is searched, the batch files are not read
+	std::vector<std::string> append_paths; // batch files appended to the network once it is built
+	std::string quarantine_path; // CSV records are validated, the malformed ones logged here
+	std::string verdicts_path; // compact verdict file written next to the text outputs
+	bool verdict_degrees; // the verdict file also holds the friendship degree of every payment
+	unsigned threads; // pool threads building the indexes and expanding giant search frontiers
+	bool pin_threads; // binds every pool thread to its own core
+} config_t;
+
+void print_usage(const char* program) {
+	cout << "Usage: " << program << " [options] [batch_payment[,batch_payment...] [stream_payment[,stream_payment...]"
+			<< " [output1 output2 output3]]]\n"
+			<< "A batch_payment may be a file, a directory or a glob pattern of files, read concurrently.\n"
+			<< "Payment files are CSV text or binary records (see paymo-convert).\n"
+			<< "Options:\n"
+			<< "  --lateness=SECONDS    release stream payments in timestamp order, allowing them\n"
+			<< "                        to arrive up to SECONDS behind the newest payment\n"
+			<< "  --late-events=FILE    log payments arriving behind the lateness watermark to FILE\n"
+			<< "                        instead of scoring them out of order\n"
+			<< "  --dedup-window=SECONDS  suppress repeated payment records seen within SECONDS\n"
+			<< "  --dedup=drop|mark     drop repeated records, or mark them and skip the search\n"
+			<< "                        (default: mark, one output line per record is kept)\n"
+			<< "  --bloom-fpr=RATE      false positive rate of the bloom filter in front of the\n"
+			<< "                        direct friendship lookup (default: 0.01, 0 disables it)\n"
+			<< "  --summary-bits=BITS   keep a BITS wide signature of every user's 2-hop network,\n"
+			<< "                        pairs with disjoint signatures skip the search\n"
+			<< "  --landmarks=COUNT     bound distances through COUNT high degree landmarks, used\n"
+			<< "                        to skip and prune searches (at most 255 landmarks)\n"
+			<< "  --hub-degree=FRIENDS  treat users with at least FRIENDS friends as hubs, the\n"
+			<< "                        search goes through them without expanding them (at most 64)\n"
+			<< "  --ball-cache=COUNT    save the distance balls of the last COUNT payers sending\n"
+			<< "                        bursts, their next payments are answered by a lookup\n"
+			<< "  --group-window=COUNT  read COUNT payments at a time and answer those of a same\n"
+			<< "                        payer with a single traversal\n"
+			<< "  --interleave=COUNT    search the payments of a window COUNT at a time on one\n"
+			<< "                        thread, hiding the cache misses of each search (at most 31)\n"
+			<< "  --search-budget=EDGES  give up a search after visiting EDGES edges, its degree\n"
+			<< "                        is undetermined between the bounds proven so far\n"
+			<< "  --search-deadline=MICROSECONDS  give up a search after MICROSECONDS (the budget and\n"
+			<< "                        deadline cap the whole cost of a payment, so they are not\n"
+			<< "                        taken with the hubs, ball cache, group window or interleave,\n"
+			<< "                        whose traversals they do not bound)\n"
+			<< "  --prefetch=yes|no     prefetch the records, neighbour lists and visited marks of\n"
+			<< "                        the frontier ahead of the search (default: no, the plain\n"
+			<< "                        search is faster on the PayMo networks: 5.3 against 8.4 us\n"
+			<< "                        per search in fraud-alert-bench)\n"
+			<< "  --frontier-sort=yes|no  sort the next frontier of the search in chunks (default:\n"
+			<< "                        no, 14.4 us per search with prefetching in the same bench)\n"
+			<< "  --undetermined=unverified|trusted  degree taken for an undetermined search: the\n"
+			<< "                        most distant (default) or the closest one not ruled out\n"
+			<< "  --service-queue=COUNT  service mode: the feeds are taken into an ingress queue of\n"
+			<< "                        COUNT payments and the queue delay of every one is measured\n"
+			<< "  --slo=MICROSECONDS    queue delay objective of the service mode (default: 10000)\n"
+			<< "  --overload=wait|shed|reject|priority  payments waiting beyond the objective are\n"
+			<< "                        scored anyway (default), scored from the direct friendships\n"
+			<< "                        and components only, not scored, or shed below the priority\n"
+			<< "                        amount\n"
+			<< "  --priority-amount=AMOUNT  overdue payments from AMOUNT up are scored in full\n"
+			<< "                        (default: 100)\n"
+			<< "  --memory-budget=MB    page the neighbour sets of cold users out to disk once the\n"
+			<< "                        accounted memory exceeds MB (searches then run on one thread)\n"
+			<< "  --append-batch=FILE[,FILE...]  append more batch files (or directories, or glob\n"
+			<< "                        patterns) to the network once it is built and indexed,\n"
+			<< "                        parsing them in parallel and merging their new edges in bulk\n"
+			<< "  --quarantine=FILE     validate every CSV payment record strictly (fields, ids,\n"
+			<< "                        timestamp and amount), malformed ones are neither loaded nor\n"
+			<< "                        scored but written to FILE with their line numbers (a\n"
+			<< "                        stream line is answered \"Malformed\" in the outputs)\n"
+			<< "  --disk-graph=FILE     write the batch network to FILE and search it from there,\n"
+			<< "                        only its offsets and the stream's edges stay in memory (not\n"
+			<< "                        with the indexes, caches, windows or a memory budget)\n"
+			<< "  --disk-graph-reuse=yes|no  search the network FILE written by an earlier run with\n"
+			<< "                        --disk-graph instead of reading the batch files (the batch\n"
+			<< "                        argument is then ignored; default: no)\n"
+			<< "  --verdicts=FILE       also write a byte of verdict flags per stream payment to FILE\n"
+			<< "                        (see verdict_file.h), in the order of the output lines\n"
+			<< "  --verdict-degrees=yes|no  add a byte of friendship degree to every verdict\n"
+			<< "                        (default: no)\n"
+			<< "  --threads=COUNT       threads building the indexes and expanding giant search\n"
+			<< "                        frontiers (default: one per core, 1 runs sequentially)\n"
+			<< "  --pin-threads=yes|no  bind every thread to its own core (default: no)\n";
+}
+
+// splits a comma separated list of paths
+vector<string> split_paths(const string& list) {
+	vector<string> paths;
+	stringstream ss(list);
+	string path;
+	while (getline(ss, path, ','))
+		if (!path.empty())
+			paths.push_back(path);
+	return paths;
+}
+
+// options are given as --name=value
+bool parse_option(const string& arg, config_t& config) {
+	string::size_type eq = arg.find('=');
+	string name = arg.substr(2, eq == string::npos ? string::npos : eq - 2);
+	string value = eq == string::npos ? "" : arg.substr(eq + 1);
+	if (name == "lateness" && !value.empty())
+		config.lateness = atol(value.c_str());
+	else if (name == "late-events" && !value.empty())
+		config.late_events_path = value;
+	else if (name == "dedup-window" && !value.empty())
+		config.dedup_window = atol(value.c_str());
+	else if (name == "dedup" && (value == "drop" || value == "mark"))
+		config.dedup = value == "drop" ? dedup_drop : dedup_mark;
+	else if (name == "bloom-fpr" && !value.empty())
+		config.bloom_fpr = atof(value.c_str());
+	else if (name == "summary-bits" && !value.empty())
+		config.summary_bits = atoi(value.c_str());
+	else if (name == "landmarks" && !value.empty())
+		config.landmarks = std::min(255, atoi(value.c_str()));
+	else if (name == "hub-degree" && !value.empty())
+		config.hub_degree = atoi(value.c_str());
+	else if (name == "ball-cache" && !value.empty())
+		config.ball_cache = atoi(value.c_str());
+	else if (name == "group-window" && !value.empty())
+		config.group_window = atoi(value.c_str());
+	else if (name == "interleave" && !value.empty())
+		config.interleave = atoi(value.c_str());
+	else if (name == "search-budget" && !value.empty())
+		config.search_budget = strtoul(value.c_str(), 0, 10);
+	else if (name == "search-deadline" && !value.empty())
+		config.search_deadline = strtoul(value.c_str(), 0, 10);
+	else if (name == "prefetch" && (value == "yes" || value == "no"))
+		config.prefetch = value == "yes";
+	else if (name == "frontier-sort" && (value == "yes" || value == "no"))
+		config.frontier_sort = value == "yes";
+	else if (name == "undetermined" && (value == "unverified" || value == "trusted"))
+		config.undetermined = value == "trusted" ? undetermined_trusted : undetermined_unverified;
+	else if (name == "service-queue" && !value.empty())
+		config.service_queue = strtoul(value.c_str(), 0, 10);
+	else if (name == "slo" && !value.empty())
+		config.slo = strtoul(value.c_str(), 0, 10);
+	else if (name == "overload" && (value == "wait" || value == "shed" || value == "reject" || value == "priority"))
+		config.overload = value == "shed" ? overload_shed : value == "reject" ? overload_reject
+				: value == "priority" ? overload_priority : overload_wait;
+	else if (name == "priority-amount" && !value.empty())
+		config.priority_amount = atof(value.c_str());
+	else if (name == "memory-budget" && !value.empty())
+		config.memory_budget = strtoul(value.c_str(), 0, 10);
+	else if (name == "append-batch" && !value.empty())
+		config.append_paths = split_paths(value);
+	else if (name == "quarantine" && !value.empty())
+		config.quarantine_path = value;
+	else if (name == "disk-graph" && !value.empty())
+		config.disk_graph_path = value;
+	else if (name == "disk-graph-reuse" && (value == "yes" || value == "no"))
+		config.disk_graph_reuse = value == "yes";
+	else if (name == "verdicts" && !value.empty())
+		config.verdicts_path = value;
+	else if (name == "verdict-degrees" && (value == "yes" || value == "no"))
+		config.verdict_degrees = value == "yes";
+	else if (name == "threads" && atoi(value.c_str()) > 0)
+		config.threads = atoi(value.c_str());
+	else if (name == "pin-threads" && (value == "yes" || value == "no"))
+		config.pin_threads = value == "yes";
+	else
+		return false;
+	return true;
+}
+
+// the first option given whose traversals run outside the search budget (hub sub-searches,
+// payer balls and window traversals), null if there is none
+const char* unbudgeted_option(const config_t& config) {
+	if (config.hub_degree > 0)
+		return "--hub-degree";
+	if (config.ball_cache > 0)
+		return "--ball-cache";
+	if (config.group_window > 1)
+		return "--group-window";
+	if (config.interleave > 0)
+		return "--interleave";
+	return 0;
+}
+
+// the first option given that searches or maintains the graph held in memory (the indexes,
+// caches, windows and paging), null if there is none
+const char* in_memory_option(const config_t& config) {
+	if (config.summary_bits > 0)
+		return "--summary-bits";
+	if (config.landmarks > 0)
+		return "--landmarks";
+	if (config.memory_budget > 0)
+		return "--memory-budget";
+	return unbudgeted_option(config);
+}
+
+bool parse_arguments(int argc, char* argv[], config_t& config) {
+	config.batch_paths = split_paths("paymo_input/batch_payment.txt");
+	config.stream_paths = split_paths("paymo_input/stream_payment.txt");
+	config.output_paths[0] = "paymo_output/output1.txt";
+	config.output_paths[1] = "paymo_output/output2.txt";
+	config.output_paths[2] = "paymo_output/output3.txt";
+	config.lateness = -1;
+	config.dedup_window = 0;
+	config.dedup = dedup_mark;
+	config.bloom_fpr = 0.01;
+	config.summary_bits = 0;
+	config.landmarks = 0;
+	config.hub_degree = 0;
+	config.ball_cache = 0;
+	config.group_window = 0;
+	config.interleave = 0;
+	config.search_budget = 0;
+	config.search_deadline = 0;
+	config.prefetch = false;
+	config.frontier_sort = false;
+	config.undetermined = undetermined_unverified;
+	config.service_queue = 0;
+	config.slo = 10000;
+	config.overload = overload_wait;
+	config.priority_amount = 100;
+	config.memory_budget = 0;
+	config.disk_graph_reuse = false;
+	config.verdict_degrees = false;
+	config.threads = std::max(1u, std::thread::hardware_concurrency());
+	config.pin_threads = false;
+
+	vector<string> positional;
+	for (int indx = 1; indx < argc; indx++) {
+		string arg = argv[indx];
+		if (arg.compare(0, 2, "--") == 0) {
+			if (!parse_option(arg, config))
+				return false;
+		} else {
+			positional.push_back(arg);
+		}
+	}
+	if (positional.size() > 5 || (positional.size() > 2 && positional.size() < 5))
+		return false;
+	if (positional.size() > 0)
+		config.batch_paths = split_paths(positional[0]);
+	if (positional.size() > 1)
+		config.stream_paths = split_paths(positional[1]);
+	for (unsigned indx = 2; indx < positional.size(); indx++)
+		config.output_paths[indx - 2] = positional[indx];
+	if (!config.late_events_path.empty() && config.lateness < 0)
+		config.lateness = 0;
+	const char* conflict = unbudgeted_option(config);
+	if ((config.search_budget > 0 || config.search_deadline > 0) && conflict) {
+		cout << (config.search_budget > 0 ? "--search-budget" : "--search-deadline") << " cannot be taken with "
+				<< conflict << ", whose traversals run outside the search budget.\n";
+		return false;
+	}
+	conflict = in_memory_option(config);
+	if (!config.disk_graph_path.empty() && conflict) {
+		cout << "--disk-graph cannot be taken with " << conflict << ", which needs the network held in memory.\n";
+		return false;
+	}
+	if (config.disk_graph_reuse && config.disk_graph_path.empty()) {
+		cout << "--disk-graph-reuse needs the network file given with --disk-graph.\n";
+		return false;
+	}
+	return !config.batch_paths.empty() && !config.stream_paths.empty();
+}
 
-	// STEP 1: Reading batch payment data from CSV file
-	ifstream batch_file("paymo_input/batch_payment.csv");
-	batch_file >> payment_data;
+int main(int argc, char* argv[]) {
 
-	if (!batch_file.eof()) {
-		cout << "Error while reading the *batch* payment file. Aborting.\n";
+	config_t config;
+	if (!parse_arguments(argc, argv, config)) {
+		print_usage(argv[0]);
 		return 1;
 	}
 
-	cout << "The *batch* payment file contains " << payment_data.size() << " records.\n";
-	batch_file.close();
+	workers.reset(new thread_pool(config.threads, config.pin_threads));
 
-	// STEP 2: Constructing a graph with the payment information contained in the batch CSV file
+	// A database will be used to hold our payment records
+	data_t payment_data;
+
+	// Malformed records are set aside with their line numbers instead of polluting the network
+	std::unique_ptr<quarantine_log> quarantine;
+	if (!config.quarantine_path.empty()) {
+		quarantine.reset(new quarantine_log());
+		if (!quarantine->open(config.quarantine_path)) {
+			cout << "Error while creating the quarantine file " << config.quarantine_path << ". Aborting.\n";
+			return 1;
+		}
+	}
+
+	// Semi-external mode: the batch edges go to a CSR file instead of the graph, unless the
+	// network file of an earlier run is mapped as it is (the batch files are then not read)
 	Graph g;
-	build_paymo_network(payment_data, g);
+	std::unique_ptr<csr_writer> csr;
+	if (!config.disk_graph_path.empty() && !config.disk_graph_reuse)
+		csr.reset(new csr_writer(config.disk_graph_path));
 
-	// STEP 3: Reading stream payment data from CSV file
-	ifstream stream_file("paymo_input/stream_payment.csv");
-	stream_file >> payment_data;
+	if (!config.disk_graph_reuse) {
+		// STEP 1: Reading batch payment data from CSV files, the partitions of the history are
+		// parsed concurrently on the pool; files of binary records are mapped as they are
+		std::vector<std::string> batch_files;
+		for (std::size_t indx = 0; indx < config.batch_paths.size(); indx++) {
+			std::vector<std::string> files = expand_batch_path(config.batch_paths[indx]);
+			batch_files.insert(batch_files.end(), files.begin(), files.end());
+		}
+		std::vector<std::unique_ptr<binary_payment_file> > binary_parts(batch_files.size());
+		std::vector<std::string> text_files;
+		std::size_t batch_records = 0;
+		for (std::size_t indx = 0; indx < batch_files.size(); indx++) {
+			if (!binary_payment_file::detect(batch_files[indx])) {
+				text_files.push_back(batch_files[indx]);
+				continue;
+			}
+			binary_parts[indx].reset(new binary_payment_file());
+			if (!binary_parts[indx]->open(batch_files[indx])) {
+				cout << "Error while reading the *batch* payment file " << batch_files[indx] << ". Aborting.\n";
+				return 1;
+			}
+			batch_records += binary_parts[indx]->size();
+		}
+		std::vector<data_t> batch_parts;
+		std::size_t failed = read_batches(text_files, batch_parts, *workers, quarantine.get());
+		if (batch_files.empty() || failed < text_files.size()) {
+			cout << "Error while reading the *batch* payment file"
+					<< (batch_files.empty() ? "" : " " + text_files[failed]) << ". Aborting.\n";
+			return 1;
+		}
 
-	if (!stream_file.eof()) {
-		cout << "Error while reading the *stream* payment file. Aborting.\n";
+		for (std::size_t indx = 0; indx < batch_parts.size(); indx++)
+			batch_records += batch_parts[indx].size();
+		if (batch_files.size() == 1)
+			cout << "The *batch* payment file contains " << batch_records << " records.\n";
+		else
+			cout << "The " << batch_files.size() << " *batch* payment files contain " << batch_records << " records.\n";
+
+		// STEP 2: Constructing a graph with the payment information contained in the batch CSV files,
+		// taken in file order so that users are numbered the same on every run; in semi-external
+		// mode the graph only gets the users, the edges are sorted into the network file
+		for (std::size_t indx = 0, text = 0; indx < batch_files.size(); indx++) {
+			if (binary_parts[indx]) {
+				if (csr)
+					build_paymo_network(*binary_parts[indx], g, *csr);
+				else
+					build_paymo_network(*binary_parts[indx], g);
+				binary_parts[indx].reset();
+			} else {
+				if (csr)
+					build_paymo_network(batch_parts[text], g, *csr);
+				else
+					build_paymo_network(batch_parts[text], g);
+				data_t().swap(batch_parts[text++]);
+			}
+		}
+
+	}
+
+	std::size_t representations[4] = { 0, 0, 0, 0 };
+	for (Vertex v = 0; v < num_vertices(g); v++)
+		representations[g.representation(v)]++;
+	cout << "The payment network uses " << g.memory() / 1024 << " KB (" << representations[inline_neighbours]
+			<< " inline, " << representations[sorted_neighbours] << " sorted, " << representations[hashed_neighbours]
+			<< " hashed and " << representations[bitmap_neighbours] << " bitmap neighbour sets).\n";
+
+	// Semi-external mode: the neighbour lists are mapped from the CSR file, only the offsets stay in memory
+	if (!config.disk_graph_path.empty()) {
+		disk.reset(new disk_graph(g));
+		if (csr) {
+			std::vector<int32_t> labels;
+			labels.reserve(nodes.size());
+			for (NodeMap::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+				labels.push_back(it->second);
+			if (!csr->write(labels)) {
+				cout << "Error while writing the network to " << config.disk_graph_path << ". Aborting.\n";
+				return 1;
+			}
+			csr.reset();
+		}
+		if (!disk->open(config.disk_graph_path)) {
+			cout << "Error while mapping the network file " << config.disk_graph_path << ". Aborting.\n";
+			return 1;
+		}
+		// the users of a reused file are numbered as they were when it was written
+		for (std::size_t v = 0; config.disk_graph_reuse && v < disk->stored_vertices(); v++) {
+			if (add_user(disk->label(v), g) != v) {
+				cout << "Error while reading the users of the network file " << config.disk_graph_path << ". Aborting.\n";
+				return 1;
+			}
+		}
+		cout << "The payment network was " << (config.disk_graph_reuse ? "mapped from " : "written to ")
+				<< config.disk_graph_path << " (" << disk->file_bytes() / 1024 << " KB, " << disk->stored_vertices()
+				<< " users), its offsets use " << disk->memory() / 1024 << " KB.\n";
+	}
+
+	if (config.bloom_fpr > 0 && config.bloom_fpr < 1) {
+		if (disk)
+			build_edge_filter(*disk, config.bloom_fpr);
+		else
+			build_edge_filter(g, config.bloom_fpr);
+		cout << "The edge bloom filter uses " << edge_filter->memory() / 1024 << " KB ("
+				<< edge_filter->hash_functions() << " hash functions, target false positive rate "
+				<< edge_filter->fpr() << ").\n";
+	}
+
+	if (config.summary_bits > 0) {
+		summaries.reset(new hop_summaries(config.summary_bits));
+		summaries->build(g, *workers);
+		cout << "The 2-hop neighbourhood signatures use " << summaries->memory() / 1024 << " KB ("
+				<< summaries->bits() << " bits per signature).\n";
+	}
+
+	if (config.landmarks > 0) {
+		landmarks.reset(new landmark_index());
+		landmarks->build(g, config.landmarks, *workers);
+		cout << "The distances to " << landmarks->size() << " landmarks use "
+				<< landmarks->memory() / 1024 << " KB.\n";
+	}
+
+	if (config.hub_degree > 0) {
+		hubs.reset(new hub_index(config.hub_degree));
+		hubs->build(g);
+		cout << "The network has " << hubs->size() << " hubs with at least " << config.hub_degree
+				<< " friends, their neighbour masks use " << hubs->memory() / 1024 << " KB.\n";
+	}
+
+	// Appended batches: parsed on the pool and merged into the network and its indexes,
+	// the cost follows the size of the new batch rather than the size of the network
+	std::vector<std::string> append_files;
+	for (std::size_t indx = 0; indx < config.append_paths.size(); indx++) {
+		std::vector<std::string> files = expand_batch_path(config.append_paths[indx]);
+		append_files.insert(append_files.end(), files.begin(), files.end());
+	}
+	for (std::size_t indx = 0; indx < append_files.size(); indx++) {
+		chrono::steady_clock::time_point started = chrono::steady_clock::now();
+		binary_payment_file binary_append;
+		bool binary = binary_payment_file::detect(append_files[indx]);
+		if (binary ? !binary_append.open(append_files[indx])
+				: !read_batch_parallel(append_files[indx], payment_data, *workers, quarantine.get())) {
+			cout << "Error while reading the appended batch file " << append_files[indx] << ". Aborting.\n";
+			return 1;
+		}
+		chrono::steady_clock::time_point parsed = chrono::steady_clock::now();
+		std::size_t added = binary ? append_batch(binary_append, g) : append_batch(payment_data, g);
+		cout << "The appended batch file " << append_files[indx] << " contains "
+				<< (binary ? binary_append.size() : payment_data.size())
+				<< " records, " << added << " new edges (parsed in "
+				<< chrono::duration_cast<chrono::milliseconds>(parsed - started).count() << " ms, merged in "
+				<< chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - parsed).count()
+				<< " ms).\n";
+		payment_data.clear();
+	}
+
+	// STEP 3: Opening the stream payment feeds. Every feed is parsed on its own thread
+	// and the feeds are merged by timestamp, the scorer sees a single ordered stream.
+	stream_merger stream_feed(config.stream_paths, quarantine.get());
+	if (!stream_feed.is_open()) {
+		cout << "Error while opening the *stream* payment file. Aborting.\n";
 		return 1;
 	}
 
-	cout << "The *stream* payment file contains " << payment_data.size() << " records.\n";
-	batch_file.close();
+	// Out of order payments are held back until the lateness watermark passes them
+	payment_source* stream = &stream_feed;
+	ofstream late_events;
+	std::unique_ptr<reorder_buffer> reorder;
+	if (config.lateness >= 0) {
+		if (!config.late_events_path.empty()) {
+			late_events.open(config.late_events_path.c_str());
+			late_events << "time, id1, id2, amount, message\n";
+		}
+		reorder.reset(new reorder_buffer(stream_feed, config.lateness, late_log,
+				late_events.is_open() ? &late_events : 0));
+		stream = reorder.get();
+	}
 
-	// STEP 4: Main processing loop. Stream payments are read sequentially and output files written
-	ofstream output1("paymo_output/output1.txt");
-	ofstream output2("paymo_output/output2.txt");
-	ofstream output3("paymo_output/output3.txt");
+	// Repeated records (upstream retries) are suppressed before they reach the search
+	std::unique_ptr<dedup_filter> dedup;
+	if (config.dedup_window > 0) {
+		dedup.reset(new dedup_filter(*stream, config.dedup_window, config.dedup));
+		stream = dedup.get();
+	}
 
-	for (unsigned int indx = 0; indx < payment_data.size(); indx++) {
+	// Service mode: the payments wait in a bounded ingress queue, the overdue ones are
+	// handled by the overload policy
+	std::unique_ptr<admission_stage> admission;
+	if (config.service_queue > 0) {
+		components.reset(new union_find());
+		if (disk)
+			components->build(*disk);
+		else
+			components->build(g);
+		admission.reset(new admission_stage(*stream, config.service_queue,
+				overload_control(config.overload, config.slo, config.priority_amount)));
+		stream = admission.get();
+	}
 
-		payment_t payment = payment_data[indx];
-		UID uid1 = payment.id1;
-		UID uid2 = payment.id2;
-		Node node1 = add_user(uid1, g);
-		Node node2 = add_user(uid2, g);
-		Connection connection = create_connection(node1, node2);
+	// paging mutates the graph under the searches, giant frontiers are then expanded sequentially
+	if (workers->size() > 1 && config.memory_budget == 0)
+		degree_search.set_pool(workers.get());
 
-		int friendship;
+	degree_search.set_budget(config.search_budget, config.search_deadline);
+	degree_search.set_prefetching(config.prefetch);
+	degree_search.set_frontier_sorting(config.frontier_sort);
+	undetermined = config.undetermined;
 
-		if (friends[perfect_hash(connection.first, connection.second)]) {
-			// if a direct connection exists between both nodes (users) then no alert is needed
-			friendship = 1;
-			std::cout << "Existing friendship between USER:" << uid1 << " and USER:" << uid2 << std::endl;
-		} else {
-			// for all other cases we will use boost::dijkstra_search_algorithm
-			friendship = friendship_degree(connection, g);
-			update_network(connection, g); // updating PayMo payment graph
-			std::cout << "The friendship degree between USER:" << uid1 << " and USER:" << uid2 << " is " << friendship << std::endl;
+	if (config.ball_cache > 0)
+		balls.reset(new ball_cache(config.ball_cache, max_degree));
+
+	if (config.group_window > 1)
+		groups.reset(new source_groups(max_degree));
+
+	if (config.interleave > 0)
+		interleaved.reset(new interleaved_bfs(config.interleave));
+
+	// Memory budget: every large structure is accounted, only the adjacency can be paged out
+	if (config.memory_budget > 0) {
+		if (!g.enable_paging()) {
+			cout << "Error while creating the adjacency spill segment. Aborting.\n";
+			return 1;
 		}
+		budget.reset(new memory_budget(config.memory_budget << 20));
+		budget->track("adjacency", [&] { return g.memory(); });
+		budget->track("user tables", [&] { return tree_memory(users) + tree_memory(nodes); });
+		budget->track("edge set", [&] { return tree_memory(friends) + (edge_filter ? edge_filter->memory() : 0); });
+		budget->track("indexes", [&] {
+			return (summaries ? summaries->memory() : 0) + (landmarks ? landmarks->memory() : 0)
+					+ (hubs ? hubs->memory() : 0) + (components ? components->memory() : 0);
+		});
+		budget->track("caches", [&] {
+			return (balls ? balls->memory() : 0) + (dedup ? dedup->memory() : 0);
+		});
+	}
 
-		output1 << (friendship>1? "Unverified" : "Trusted") << std::endl;
-		output2 << (friendship>2? "Unverified" : "Trusted") << std::endl;
-		output3 << (friendship>4? "Unverified" : "Trusted") << std::endl;
+	// STEP 4: Main processing loop. Stream payments are read sequentially and output files written
+	ofstream output1(config.output_paths[0].c_str());
+	ofstream output2(config.output_paths[1].c_str());
+	ofstream output3(config.output_paths[2].c_str());
+	std::unique_ptr<verdict_writer> verdicts;
+	if (!config.verdicts_path.empty()) {
+		verdicts.reset(new verdict_writer(config.verdict_degrees));
+		if (!verdicts->open(config.verdicts_path)) {
+			cout << "Error while creating the verdict file " << config.verdicts_path << ". Aborting.\n";
+			return 1;
+		}
+	}
+
+	// Payments are read a window at a time (a single payment unless they are grouped by payer
+	// or searched together)
+	payment_t payment;
+	unsigned long stream_records = 0;
+	std::size_t window_size = std::max(1u, config.group_window);
+	if (interleaved && config.group_window == 0)
+		window_size = interleave_window * interleaved->in_flight();
+	std::vector<payment_t> window;
+	std::vector<Connection> window_payments;
+	std::vector<Vertex> window_users;
+	for (;;) {
+		window.clear();
+		while (window.size() < window_size && stream->next(payment))
+			window.push_back(payment);
+		if (window.empty())
+			break;
+
+		if (groups || interleaved) {
+			// the saved answers are checked against the edges inserted during the window, whose
+			// endpoints are the users of every payment that may reach update_network (repeated
+			// records and the payments left to the cheap signals included); only the payments
+			// to be searched are searched
+			window_payments.clear();
+			window_users.clear();
+			for (std::size_t indx = 0; indx < window.size(); indx++) {
+				if (window[indx].malformed || window[indx].scoring == score_rejected)
+					continue;
+				Connection payment(add_user(window[indx].id1, g), add_user(window[indx].id2, g));
+				window_users.push_back(payment.first);
+				window_users.push_back(payment.second);
+				if (!window[indx].duplicate && window[indx].scoring == score_full)
+					window_payments.push_back(payment);
+			}
+			if (groups)
+				groups->prepare(g, degree_search, window_payments, window_users);
+			if (interleaved)
+				interleaved->prepare(g, window_payments, window_users, max_degree);
+		}
+
+		for (std::size_t indx = 0; indx < window.size(); indx++) {
+			stream_records++;
+			bool determined;
+			int friendship = score_payment(window[indx], g, determined);
 
+			if (friendship == rejected_payment || friendship == malformed_payment) {
+				const char* verdict = friendship == rejected_payment ? "Rejected" : "Malformed";
+				output1 << verdict << std::endl;
+				output2 << verdict << std::endl;
+				output3 << verdict << std::endl;
+			} else {
+				output1 << (friendship>1? "Unverified" : "Trusted") << std::endl;
+				output2 << (friendship>2? "Unverified" : "Trusted") << std::endl;
+				output3 << (friendship>4? "Unverified" : "Trusted") << std::endl;
+			}
+			if (verdicts) {
+				uint8_t flags = window[indx].duplicate ? verdict_duplicate : 0;
+				if (friendship == rejected_payment)
+					verdicts->write(flags | verdict_rejected, 0);
+				else if (friendship == malformed_payment)
+					verdicts->write(flags | verdict_malformed, 0);
+				else
+					verdicts->write(flags | (friendship > 1 ? verdict_unverified1 : 0)
+							| (friendship > 2 ? verdict_unverified2 : 0) | (friendship > 4 ? verdict_unverified3 : 0)
+							| (determined ? 0 : verdict_undetermined) | (friendship == 0 ? verdict_self : 0),
+							std::min(friendship, beyond_network));
+			}
+			if (admission)
+				admission->completed();
+			if (budget && stream_records % budget_interval == 0) {
+				// pages out down to 90% of the budget, so that the next checks do not page again at once
+				std::size_t used = budget->total();
+				if (used > budget->limit())
+					g.page_out_cold(used - budget->limit() / 10 * 9);
+			}
+		}
 	}
 
 	output1.close();
 	output2.close();
 	output3.close();
+	if (verdicts && !verdicts->close()) {
+		cout << "Error while writing the verdict file " << config.verdicts_path << ". Aborting.\n";
+		return 1;
+	}
+
+	if (!stream_feed.good()) {
+		cout << "Error while reading the *stream* payment file. Aborting.\n";
+		return 1;
+	}
+	if (quarantine && !quarantine->close()) {
+		cout << "Error while writing the quarantine file " << config.quarantine_path << ". Aborting.\n";
+		return 1;
+	}
+
+	cout << "The *stream* payment files contained " << stream_records << " records.\n";
+	if (quarantine)
+		cout << quarantine->size() << " malformed payment records quarantined to " << config.quarantine_path << ".\n";
+	if (verdicts)
+		cout << verdicts->records() << " verdicts written to " << config.verdicts_path << " ("
+				<< verdicts->records() * (config.verdict_degrees ? 2 : 1) / 1024 << " KB).\n";
+	if (reorder)
+		cout << reorder->late_payments() << " payments arrived behind the lateness watermark.\n";
+	if (dedup)
+		cout << dedup->duplicates() << " duplicate payments suppressed ("
+				<< dedup->memory() / 1024 << " KB of dedup window).\n";
+	if (dedup && dedup->shortened_windows() > 0)
+		cout << dedup->shortened_windows() << " dedup generations dropped before the end of the window to stay within its capacity.\n";
+	if (edge_filter)
+		cout << rejected_lookups << " direct friendship lookups rejected by the edge bloom filter ("
+				<< edge_filter->memory() / 1024 << " KB, expected false positive rate "
+				<< edge_filter->expected_fpr() << ").\n";
+	if (summaries)
+		cout << summary_rejections << " payments proven beyond the " << max_degree
+				<< "th degree by the 2-hop signatures.\n";
+	if (landmarks)
+		cout << landmark_rejections << " payments proven beyond the " << max_degree
+				<< "th degree by the landmark distances.\n";
+	if (balls)
+		cout << balls->balls_built() << " payer balls saved, " << balls->lookups() - balls->balls_built()
+				<< " later payments answered from them (" << balls->balls_patched() << " patches, "
+				<< balls->balls_dropped() << " dropped, " << balls->memory() / 1024 << " KB).\n";
+	if (groups)
+		cout << groups->grouped_traversals() << " payer traversals answered " << groups->grouped_answers()
+				<< " grouped payments, " << groups->grouped_fallbacks() << " fell back to a search after an insertion.\n";
+	if (interleaved)
+		cout << interleaved->interleaved_searches() << " searches interleaved " << interleaved->in_flight()
+				<< " at a time, " << interleaved->interleaved_answers() << " answers used, "
+				<< interleaved->interleaved_fallbacks() << " fell back to a search after an insertion.\n";
+	if (admission) {
+		const latency_histogram& delays = admission->queue_delays();
+		const latency_histogram& sojourns = admission->sojourn_times();
+		cout << "Service mode: " << admission->scored(score_full) << " payments scored in full, "
+				<< admission->scored(score_cheap) << " from the cheap signals, "
+				<< admission->scored(score_rejected) << " rejected (" << components->components()
+				<< " components).\n";
+		cout << "Queue delay (us): p50 " << delays.percentile(0.5) / 1000 << ", p99 " << delays.percentile(0.99) / 1000
+				<< ", p99.9 " << delays.percentile(0.999) / 1000 << ", max " << delays.max() / 1000 << ".\n";
+		cout << "Sojourn time (us): p50 " << sojourns.percentile(0.5) / 1000 << ", p99 "
+				<< sojourns.percentile(0.99) / 1000 << ", p99.9 " << sojourns.percentile(0.999) / 1000
+				<< ", max " << sojourns.max() / 1000 << ".\n";
+	}
+	if (budget) {
+		cout << g.paged_out() << " neighbour sets paged out (" << g.segment_bytes() / 1024 << " KB of segment), "
+				<< g.paged_in() << " paged back in. Memory accounting:\n";
+		budget->report(cout);
+	}
+	if (disk)
+		cout << "The searches read the network file ahead in " << disk->read_runs() << " runs of "
+				<< disk->read_pages() << " pages, " << g.edges() << " stream edges kept in memory ("
+				<< g.memory() / 1024 << " KB).\n";
+	if (config.search_budget > 0 || config.search_deadline > 0)
+		cout << degree_search.overrun_count() << " searches ran out of budget, " << undetermined_degrees
+				<< " friendship degrees left undetermined.\n";
+	if (workers->size() > 1)
+		cout << degree_search.parallel_levels() << " search levels expanded on " << workers->size() << " threads.\n";
+	if (hubs)
+		cout << hub_searches << " searches went through " << hubs->size() << " hubs without expanding them.\n";
 
 	/* Visualization of PayMo network */
-	build_visualization(g);
+	if (disk)
+		build_visualization(*disk);
+	else
+		build_visualization(g);
 
 	cout << "Processing completed.\n";
 	return 0;
 }
-
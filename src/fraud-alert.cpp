@@ -20,6 +20,7 @@
 #include <set>
 #include <map>
 #include <climits>
+#include <memory>
 
 #include <boost/config.hpp>
 #include <boost/graph/graph_traits.hpp>
@@ -28,6 +29,8 @@
 #include <boost/graph/breadth_first_search.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 
+#include "bloom_filter.h"
+
 using namespace std;
 using namespace boost;
 
@@ -66,6 +69,22 @@ NodeMap nodes;
 // mantain a set of all one-to-one connections (payments,edges)
 set<Connection> connections;
 
+// bloom filter over the packed connections, rejects most lookups of new pairs
+// before they reach the connections set (false positive rate of 1%)
+std::unique_ptr<blocked_bloom_filter> connection_filter;
+const double connection_filter_fpr = 0.01;
+
+// (re)builds the connection bloom filter with room for the network to double
+void build_connection_filter() {
+	std::size_t capacity = 2 * connections.size();
+	if (connection_filter)
+		connection_filter->reset(capacity);
+	else
+		connection_filter.reset(new blocked_bloom_filter(capacity, connection_filter_fpr));
+	for (set<Connection>::iterator it = connections.begin(); it != connections.end(); ++it)
+		connection_filter->insert(pack_pair(it->first, it->second));
+}
+
 // By convention we create connections always using the smaller node number
 // in the first position and the bigger node number in the second position
 Connection create_connection(Node node1, Node node2) {
@@ -104,6 +123,11 @@ void update_network(Connection connection, Graph& g) {
 	if (!edge(v0, v1, g).second) { // according to our convention v0 is always smaller than v1
 		add_edge(connection.first, connection.second, weight, g); // adding new edge to paymo graph
 		connections.insert(connection); // registering one-to-one association
+		if (connection_filter) {
+			connection_filter->insert(pack_pair(connection.first, connection.second));
+			if (connection_filter->saturated())
+				build_connection_filter();
+		}
 	}
 }
 
@@ -245,7 +269,7 @@ int main() {
 	data_t payment_data;
 
 	// STEP 1: Reading batch payment data from CSV file
-	ifstream batch_file("paymo_input/batch_payment.csv");
+	ifstream batch_file("paymo_input/batch_payment.txt");
 	batch_file >> payment_data;
 
 	if (!batch_file.eof()) {
@@ -259,9 +283,11 @@ int main() {
 	// STEP 2: Constructing a graph with the payment information contained in the batch CSV file
 	Graph g;
 	build_paymo_network(payment_data, g);
+	build_connection_filter();
+	cout << "The connection bloom filter uses " << connection_filter->memory() / 1024 << " KB.\n";
 
 	// STEP 3: Reading stream payment data from CSV file
-	ifstream stream_file("paymo_input/stream_payment.csv");
+	ifstream stream_file("paymo_input/stream_payment.txt");
 	stream_file >> payment_data;
 
 	if (!stream_file.eof()) {
@@ -288,7 +314,8 @@ int main() {
 
 		int friendship;
 
-		if (connections.find(connection)!=connections.end()) {
+		if (connection_filter->may_contain(pack_pair(connection.first, connection.second))
+				&& connections.find(connection)!=connections.end()) {
 			// if a direct connection exists between both nodes (users) then no alert is needed
 			friendship = 1;
 			std::cout << "Existing friendship between USER:" << uid1 << " and USER:" << uid2 << std::endl;
@@ -0,0 +1,53 @@
+/*
+ * hash.h
+ *
+ * Small and fast 64-bit hash functions used by the probabilistic filters
+ * and hash tables of the fraud alert programs.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+
+// finalizer of MurmurHash3, every input bit affects every output bit
+// REF: https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp
+inline uint64_t mix64(uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+// hashes a byte string eight bytes at a time (multiply-xorshift rounds over
+// unaligned 64-bit loads), far cheaper than a byte wise FNV for our short records
+inline uint64_t hash_bytes(const void* data, std::size_t length, uint64_t seed = 0) {
+	const uint64_t m = 0x9e3779b97f4a7c15ULL;
+	const char* p = static_cast<const char*>(data);
+	uint64_t h = seed ^ (length * m);
+	while (length >= 8) {
+		uint64_t word;
+		std::memcpy(&word, p, 8);
+		h = (h ^ word) * m;
+		h ^= h >> 29;
+		p += 8;
+		length -= 8;
+	}
+	uint64_t tail = 0;
+	std::memcpy(&tail, p, length);
+	h = (h ^ tail) * m;
+	return mix64(h);
+}
+
+// packs an (ordered) pair of 32-bit node numbers into a single 64-bit key
+inline uint64_t pack_pair(uint32_t a, uint32_t b) {
+	return ((uint64_t) a << 32) | b;
+}
+
+#endif /* HASH_H_ */
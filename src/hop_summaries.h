@@ -0,0 +1,129 @@
+/*
+ * hop_summaries.h
+ *
+ * Per vertex bit signatures of the 2-hop neighbourhood. Two users are within
+ * the 4th degree only if their 2-hop balls share a vertex, so when the
+ * signatures of both balls share no bit the payment can be answered as
+ * "beyond the 4th degree" without any traversal.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef HOP_SUMMARIES_H_
+#define HOP_SUMMARIES_H_
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "hash.h"
+#include "thread_pool.h"
+
+/* Every vertex w is hashed to one bit of a fixed size signature. The 1-hop
+ * signature of u has the bits of u and its neighbours, the 2-hop signature
+ * ORs the 1-hop signatures of u and its neighbours. Signatures are Bloom
+ * filters with a single hash function, so a shared bit may be a collision
+ * but no shared bit proves that the balls are disjoint. They only ever gain
+ * bits as edges are added, which keeps the incremental update a few ORs.
+ */
+class hop_summaries {
+private:
+	unsigned words; // 64-bit words per signature
+	std::vector<uint64_t> one_hop;
+	std::vector<uint64_t> two_hop;
+
+	uint64_t* sig1(std::size_t v) { return &one_hop[v * words]; }
+	uint64_t* sig2(std::size_t v) { return &two_hop[v * words]; }
+
+	void set_bit(uint64_t* sig, std::size_t w) const {
+		uint64_t bit = mix64(w) % (words * 64);
+		sig[bit >> 6] |= (uint64_t) 1 << (bit & 63);
+	}
+
+	void merge(uint64_t* into, const uint64_t* from) const {
+		for (unsigned indx = 0; indx < words; indx++)
+			into[indx] |= from[indx];
+	}
+
+	template <typename Graph>
+	void build_one_hop(const Graph& g, std::size_t first, std::size_t last) {
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (std::size_t v = first; v < last; v++) {
+			set_bit(sig1(v), v);
+			for (boost::tie(vi, vi_end) = adjacent_vertices(v, g); vi != vi_end; ++vi)
+				set_bit(sig1(v), *vi);
+		}
+	}
+
+	template <typename Graph>
+	void build_two_hop(const Graph& g, std::size_t first, std::size_t last) {
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (std::size_t v = first; v < last; v++) {
+			merge(sig2(v), sig1(v));
+			for (boost::tie(vi, vi_end) = adjacent_vertices(v, g); vi != vi_end; ++vi)
+				merge(sig2(v), sig1(*vi));
+		}
+	}
+
+	// runs one build phase over all vertices, in ranges handed out by the pool
+	template <typename Graph>
+	void parallel_build(const Graph& g, void (hop_summaries::*phase)(const Graph&, std::size_t, std::size_t),
+			thread_pool& pool) {
+		pool.parallel_for(0, num_vertices(g), 1024, [&](std::size_t first, std::size_t last, unsigned worker) {
+			(this->*phase)(g, first, last);
+		});
+	}
+public:
+	// signature size in bits, rounded up to whole 64-bit words
+	explicit hop_summaries(unsigned bits) : words(bits > 64 ? (bits + 63) / 64 : 1) {}
+
+	// builds the signatures of every vertex of the graph on the pool
+	template <typename Graph>
+	void build(const Graph& g, thread_pool& pool) {
+		one_hop.assign(num_vertices(g) * words, 0);
+		two_hop.assign(num_vertices(g) * words, 0);
+		parallel_build<Graph>(g, &hop_summaries::build_one_hop<Graph>, pool);
+		parallel_build<Graph>(g, &hop_summaries::build_two_hop<Graph>, pool);
+	}
+
+	// a vertex added to the graph starts with its own bit only
+	void add_vertex(std::size_t v) {
+		if ((v + 1) * words > one_hop.size()) {
+			one_hop.resize((v + 1) * words, 0);
+			two_hop.resize((v + 1) * words, 0);
+		}
+		set_bit(sig1(v), v);
+		set_bit(sig2(v), v);
+	}
+
+	// updates the signatures after the edge (a, b) was added to the graph: a and b gain
+	// each other's 1-hop ball, the neighbours of a gain b and the neighbours of b gain a
+	template <typename Graph>
+	void add_edge(std::size_t a, std::size_t b, const Graph& g) {
+		set_bit(sig1(a), b);
+		set_bit(sig1(b), a);
+		merge(sig2(a), sig1(b));
+		merge(sig2(b), sig1(a));
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (boost::tie(vi, vi_end) = adjacent_vertices(a, g); vi != vi_end; ++vi)
+			set_bit(sig2(*vi), b);
+		for (boost::tie(vi, vi_end) = adjacent_vertices(b, g); vi != vi_end; ++vi)
+			set_bit(sig2(*vi), a);
+	}
+
+	// true when the 2-hop balls of u and v are disjoint, i.e. u and v are more than 4 hops apart
+	bool far_apart(std::size_t u, std::size_t v) const {
+		const uint64_t* su = &two_hop[u * words];
+		const uint64_t* sv = &two_hop[v * words];
+		uint64_t shared = 0;
+		for (unsigned indx = 0; indx < words; indx++)
+			shared |= su[indx] & sv[indx];
+		return shared == 0;
+	}
+
+	unsigned bits() const { return words * 64; }
+	std::size_t memory() const { return (one_hop.capacity() + two_hop.capacity()) * sizeof(uint64_t); }
+};
+
+#endif /* HOP_SUMMARIES_H_ */
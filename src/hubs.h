@@ -0,0 +1,206 @@
+/*
+ * hubs.h
+ *
+ * Hub aware friendship search. A few merchant like accounts have hundreds
+ * of thousands of counterparties, and expanding one of them inside the
+ * bounded search costs as much as thousands of ordinary queries. Hubs are
+ * detected by a degree threshold and the search resolves paths through
+ * them with bit tests, never enumerating their adjacency.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef HUBS_H_
+#define HUBS_H_
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "bounded_bfs.h"
+
+const unsigned max_hubs = 64; // one bit per hub in a 64-bit mask
+const uint8_t no_hub = 255;
+const uint8_t far_hubs = 255; // hubs more than 2 hops apart
+
+/* Every vertex carries a 64-bit mask with bit i set when it is a neighbour of
+ * hub i (i.e. the neighbour bitmaps of the hubs, stored transposed so that
+ * one load answers for all hubs), and the hubs keep their pairwise distances
+ * when they are at most 2 hops apart.
+ *
+ * A shortest path of length <= 4 between two ordinary users s and t either
+ * avoids the hubs, or enters a first hub Hi and leaves a last hub Hj:
+ *   d(s,t) = ds(Hi) + d(Hi,Hj) + dt(Hj)
+ * with ds and dt measured along hub free paths and d(Hi,Hj) <= 2 (both ends
+ * need at least one hop). The search from s never expands a hub, and ds(Hi)
+ * falls out of the masks of the vertices it visits; dt(Hj) comes from the
+ * mask of t and, only when a hub was reached early enough, from a short hub
+ * free search from t.
+ */
+class hub_index {
+private:
+	std::size_t threshold;
+	std::vector<std::size_t> hubs;
+	std::vector<uint8_t> slot; // hub number of a vertex, no_hub for ordinary vertices
+	std::vector<uint64_t> mask; // bit i: the vertex is a neighbour of hub i
+	uint8_t hub_distance[max_hubs][max_hubs];
+
+	void link(unsigned i, unsigned j, uint8_t d) {
+		if (d < hub_distance[i][j])
+			hub_distance[i][j] = hub_distance[j][i] = d;
+	}
+
+	// the vertex y became a neighbour of hub i
+	void add_neighbour(unsigned i, std::size_t y) {
+		for (uint64_t others = mask[y] & ~((uint64_t) 1 << i); others; others &= others - 1)
+			link(i, __builtin_ctzll(others), 2); // y is a common neighbour
+		mask[y] |= (uint64_t) 1 << i;
+		if (slot[y] != no_hub)
+			link(i, slot[y], 1);
+	}
+
+	template <typename Graph>
+	void promote(std::size_t v, const Graph& g) {
+		unsigned i = hubs.size();
+		hubs.push_back(v);
+		slot[v] = i;
+		hub_distance[i][i] = 0;
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (boost::tie(vi, vi_end) = adjacent_vertices(v, g); vi != vi_end; ++vi)
+			add_neighbour(i, *vi);
+	}
+
+	// records, for every hub, the shortest hub free distance found so far
+	struct hub_gathering {
+		const hub_index& index;
+		uint8_t* reached; // reached[i]: hub free distance to hub i
+		bool operator()(std::size_t vertex, int distance) const {
+			index.gather(vertex, distance, reached);
+			return index.slot[vertex] != no_hub;
+		}
+	};
+
+	template <typename Prune>
+	struct hub_pruning {
+		hub_gathering gathering;
+		Prune prune;
+		bool operator()(std::size_t vertex, int distance) const {
+			return gathering(vertex, distance) || prune(vertex, distance);
+		}
+	};
+
+	void gather(std::size_t vertex, int distance, uint8_t* reached) const {
+		for (uint64_t bits = mask[vertex]; bits; bits &= bits - 1) {
+			unsigned i = __builtin_ctzll(bits);
+			if (distance + 1 < reached[i])
+				reached[i] = distance + 1;
+		}
+	}
+
+	int combine(const uint8_t* ds, const uint8_t* dt, int best) const {
+		unsigned n = hubs.size();
+		for (unsigned i = 0; i < n; i++) {
+			if (ds[i] >= best)
+				continue;
+			for (unsigned j = 0; j < n; j++)
+				if (hub_distance[i][j] != far_hubs && ds[i] + hub_distance[i][j] + dt[j] < best)
+					best = ds[i] + hub_distance[i][j] + dt[j];
+		}
+		return best;
+	}
+public:
+	explicit hub_index(std::size_t threshold) : threshold(threshold > 1 ? threshold : 2) {
+		std::fill(&hub_distance[0][0], &hub_distance[0][0] + max_hubs * max_hubs, far_hubs);
+	}
+
+	// picks every vertex with at least threshold neighbours (the largest ones first if
+	// there are more than max_hubs of them) and marks their neighbours
+	template <typename Graph>
+	void build(const Graph& g) {
+		std::size_t n = num_vertices(g);
+		slot.assign(n, no_hub);
+		mask.assign(n, 0);
+		std::vector<std::pair<std::size_t, std::size_t> > candidates;
+		for (std::size_t v = 0; v < n; v++)
+			if (out_degree(v, g) >= threshold)
+				candidates.push_back(std::make_pair(out_degree(v, g), v));
+		std::sort(candidates.rbegin(), candidates.rend());
+		for (std::size_t indx = 0; indx < candidates.size() && hubs.size() < max_hubs; indx++)
+			promote(candidates[indx].second, g);
+	}
+
+	void add_vertex(std::size_t v) {
+		if (v >= slot.size()) {
+			slot.resize(v + 1, no_hub);
+			mask.resize(v + 1, 0);
+		}
+	}
+
+	// keeps the masks and hub distances current after the edge (a, b) was added, a
+	// vertex crossing the degree threshold becomes a hub while there are free slots
+	template <typename Graph>
+	void add_edge(std::size_t a, std::size_t b, const Graph& g) {
+		if (slot[a] != no_hub)
+			add_neighbour(slot[a], b);
+		else if (out_degree(a, g) >= threshold && hubs.size() < max_hubs)
+			promote(a, g);
+		if (slot[b] != no_hub)
+			add_neighbour(slot[b], a);
+		else if (out_degree(b, g) >= threshold && hubs.size() < max_hubs)
+			promote(b, g);
+	}
+
+	bool is_hub(std::size_t v) const { return slot[v] != no_hub; }
+	std::size_t size() const { return hubs.size(); }
+	std::size_t memory() const { return slot.capacity() + mask.capacity() * sizeof(uint64_t); }
+
+	// distance between s and t up to max_distance (max_distance + 1 beyond it), resolving
+	// paths through hubs without expanding them; prune is applied on top of the hub rule
+	// (the ends are swapped when only s is a hub, a pruning aimed at t should avoid that)
+	template <typename Graph, typename Prune>
+	int distance(const Graph& g, bounded_bfs& search, std::size_t s, std::size_t t, int max_distance, Prune prune) {
+		if (s == t)
+			return 0;
+		if (max_distance > 4)
+			return search.distance(g, s, t, max_distance, prune); // the hub distances only resolve 4 hops
+		if (is_hub(s) && is_hub(t)) {
+			uint8_t d = hub_distance[slot[s]][slot[t]];
+			if (d != far_hubs)
+				return d;
+			return search.distance(g, s, t, max_distance, prune); // rare: two hubs far apart
+		}
+		if (is_hub(s))
+			std::swap(s, t);
+
+		uint8_t ds[max_hubs], dt[max_hubs];
+		std::fill(ds, ds + max_hubs, far_hubs);
+		std::fill(dt, dt + max_hubs, far_hubs);
+		gather(s, 0, ds);
+		hub_pruning<Prune> forward = { { *this, ds }, prune };
+		int best = search.distance(g, s, t, max_distance, forward);
+
+		// what the mask of t tells (t itself when it is a hub), then a short hub free
+		// search from t when a hub was reached early enough to still improve on best
+		if (is_hub(t))
+			dt[slot[t]] = 0;
+		gather(t, 0, dt);
+		best = combine(ds, dt, best);
+		uint8_t nearest = *std::min_element(ds, ds + max_hubs);
+		if (is_hub(t)) {
+			// a path s - Hi - x - y - t is not covered by the hub distances (kept up to 2
+			// hops), in that case only the plain search can tell
+			if (best > max_distance)
+				for (unsigned i = 0; i < hubs.size(); i++)
+					if (ds[i] == 1 && hub_distance[i][slot[t]] == far_hubs)
+						return search.distance(g, s, t, max_distance, prune);
+		} else if (nearest != far_hubs && nearest + 2 < best) {
+			hub_gathering backward = { *this, dt };
+			search.explore(g, t, best - 2 - nearest, backward);
+			best = combine(ds, dt, best);
+		}
+		return best > max_distance ? max_distance + 1 : best;
+	}
+};
+
+#endif /* HUBS_H_ */
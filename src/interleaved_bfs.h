@@ -0,0 +1,282 @@
+/*
+ * interleaved_bfs.h
+ *
+ * Bounded searches of independent payments run as coroutines, interleaved on
+ * one thread. A single search spends most of its time waiting on cache
+ * misses; here every search issues the loads of its next step, suspends, and
+ * the scheduler resumes the other searches in flight while the lines arrive
+ * (asynchronous memory access chaining).
+ * REF: Kocberber, Falsafi, Grot, "Asynchronous Memory Access Chaining" (VLDB 2015)
+ * REF: Jonathan, Minhas, Rupprecht, et al., "Exploiting Coroutines to Attack the Killer Nanoseconds" (VLDB 2018)
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef INTERLEAVED_BFS_H_
+#define INTERLEAVED_BFS_H_
+
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "bounded_bfs.h"
+
+const unsigned max_lanes = 31; // searches in flight, one visited bit each
+const uint32_t window_user_mark = 0x80000000; // the remaining bit marks the users of the window
+const std::size_t lane_block = 4; // frontier vertices expanded between two suspensions
+
+/* The coroutine of one search, suspended at its start and at every load it
+ * waits for; the scheduler resumes it until it is done. */
+class search_task {
+public:
+	struct promise_type {
+		search_task get_return_object() {
+			return search_task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept { return std::suspend_always(); }
+		std::suspend_always final_suspend() noexcept { return std::suspend_always(); }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+private:
+	std::coroutine_handle<promise_type> handle;
+
+	search_task(const search_task&);
+	search_task& operator=(const search_task&);
+public:
+	search_task() : handle(0) {}
+	explicit search_task(std::coroutine_handle<promise_type> h) : handle(h) {}
+	search_task(search_task&& other) : handle(other.handle) { other.handle = 0; }
+	search_task& operator=(search_task&& other) {
+		std::swap(handle, other.handle);
+		return *this;
+	}
+	~search_task() {
+		if (handle)
+			handle.destroy();
+	}
+
+	bool done() const { return !handle || handle.done(); }
+	void resume() { handle.resume(); }
+};
+
+/* A window of payments is searched on the network as it stands at the start
+ * of the window, up to lanes searches at a time. The visited marks of all of
+ * them share one word per vertex (a bit per lane), and the marks a search set
+ * are cleared when it finishes so the lane can take the next payment.
+ *
+ * The payments are then scored in stream order, each one inserting its edge,
+ * so a saved distance d0(s, t) is checked against the edges inserted since the
+ * window started (as in source_groups.h): a shorter path has a first new edge
+ * (x, y) and is d_old(s, x) + 1 + d(y, t) long. The search records the
+ * distance of every window user it meets (the endpoints of every payment that
+ * may insert an edge, see prepare), and a window user it did not meet is at
+ * least d0 away, so only the recorded ones can matter; d(y, t) is tested with
+ * the edge and intersection kernels while it has to be at most 2. A longer
+ * remaining distance, or an edge from a user outside the window, falls back
+ * to a regular search.
+ */
+class interleaved_bfs {
+private:
+	struct query {
+		std::size_t source;
+		std::size_t target;
+		int distance;
+		std::vector<std::pair<std::size_t, int> > reached; // window users closer than distance
+	};
+
+	struct lane {
+		uint32_t bit;
+		std::vector<std::size_t> frontier;
+		std::vector<std::size_t> next_frontier;
+		std::vector<std::size_t> touched; // vertices whose mark is to be cleared
+		search_task task;
+		bool busy;
+	};
+
+	std::vector<lane> lanes;
+	std::vector<uint32_t> marks; // a visited bit per lane, and the window user bit
+	std::vector<std::size_t> users; // the window users, marked until the next window starts
+	std::vector<query> queries;
+	std::unordered_map<uint64_t, std::size_t> by_pair;
+	std::vector<std::pair<std::size_t, std::size_t> > inserted; // edges added since the window started
+	unsigned long searches, answers, fallbacks;
+
+	static uint64_t key(std::size_t source, std::size_t target) {
+		return ((uint64_t) source << 32) | (uint32_t) target;
+	}
+
+	template <typename Graph>
+	search_task search(const Graph& g, lane& l, query& q, int max_distance) {
+		uint32_t bit = l.bit;
+		q.distance = max_distance + 1;
+		if (q.source == q.target) {
+			q.distance = 0;
+			co_return;
+		}
+		marks[q.source] |= bit;
+		l.touched.push_back(q.source);
+		l.frontier.assign(1, q.source);
+		prefetch_vertex(q.source, g);
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (int depth = 1; depth <= max_distance && !l.frontier.empty(); depth++) {
+			l.next_frontier.clear();
+			for (std::size_t indx = 0; indx < l.frontier.size(); indx++) {
+				std::size_t x = l.frontier[indx];
+				if (indx % lane_block == 0) {
+					// the records of the block after next, the neighbour lists of the next one
+					for (std::size_t ahead = indx + lane_block; ahead < std::min(l.frontier.size(), indx + 2 * lane_block); ahead++)
+						prefetch_vertex(l.frontier[ahead], g);
+					for (std::size_t ahead = indx; ahead < std::min(l.frontier.size(), indx + lane_block); ahead++)
+						prefetch_adjacency(l.frontier[ahead], g);
+					co_await std::suspend_always();
+				}
+				for (boost::tie(vi, vi_end) = adjacent_vertices(x, g); vi != vi_end; ++vi) {
+					std::size_t y = *vi;
+					if (y == q.target) {
+						q.distance = depth;
+						co_return;
+					}
+					uint32_t mark = marks[y];
+					if (mark & bit)
+						continue;
+					marks[y] = mark | bit;
+					l.touched.push_back(y);
+					if (mark & window_user_mark)
+						q.reached.push_back(std::make_pair(y, depth));
+					if (depth < max_distance)
+						l.next_frontier.push_back(y);
+				}
+			}
+			l.frontier.swap(l.next_frontier);
+			// the first records of the next level
+			for (std::size_t ahead = 0; ahead < std::min(l.frontier.size(), lane_block); ahead++)
+				prefetch_vertex(l.frontier[ahead], g);
+			co_await std::suspend_always();
+		}
+	}
+
+	void finish(lane& l) {
+		for (std::size_t indx = 0; indx < l.touched.size(); indx++)
+			marks[l.touched[indx]] &= ~l.bit;
+		l.touched.clear();
+		l.task = search_task();
+		l.busy = false;
+	}
+
+	// whether a path through the new edge, entered at x and left at y, may beat the saved distance
+	template <typename Graph>
+	bool may_shorten(const Graph& g, const query& q, std::size_t x, std::size_t y) const {
+		if (x >= marks.size() || !(marks[x] & window_user_mark))
+			return true; // not a window user: the search did not record its distance, it may be close
+		int dx = q.distance;
+		if (x == q.source)
+			dx = 0;
+		for (std::size_t indx = 0; indx < q.reached.size() && dx == q.distance; indx++)
+			if (q.reached[indx].first == x)
+				dx = q.reached[indx].second;
+		int room = q.distance - dx - 1; // the path is shorter iff d(y, target) < room
+		if (room <= 0)
+			return false;
+		if (y == q.target || room > 3)
+			return true;
+		return (room >= 2 && g.has_edge(y, q.target)) || (room == 3 && g.intersects(y, q.target));
+	}
+public:
+	explicit interleaved_bfs(unsigned in_flight) : lanes(std::max(1u, std::min(max_lanes, in_flight))),
+		searches(0), answers(0), fallbacks(0) {
+		for (std::size_t indx = 0; indx < lanes.size(); indx++) {
+			lanes[indx].bit = 1u << indx;
+			lanes[indx].busy = false;
+		}
+	}
+
+	std::size_t in_flight() const { return lanes.size(); }
+
+	// searches every (source, target) pair of a window, up to in_flight() at a time; window_users are
+	// the endpoints of every payment of the window that may insert an edge, searched or not
+	template <typename Graph>
+	void prepare(const Graph& g, const std::vector<std::pair<std::size_t, std::size_t> >& payments,
+			const std::vector<std::size_t>& window_users, int max_distance) {
+		inserted.clear();
+		by_pair.clear();
+		queries.resize(payments.size());
+		if (marks.size() < num_vertices(g))
+			marks.resize(num_vertices(g) + num_vertices(g) / 2, 0);
+		for (std::size_t indx = 0; indx < users.size(); indx++)
+			marks[users[indx]] &= ~window_user_mark;
+		users = window_users;
+		for (std::size_t indx = 0; indx < payments.size(); indx++) {
+			queries[indx].source = payments[indx].first;
+			queries[indx].target = payments[indx].second;
+			queries[indx].reached.clear();
+			by_pair[key(payments[indx].first, payments[indx].second)] = indx;
+		}
+		for (std::size_t indx = 0; indx < window_users.size(); indx++)
+			marks[window_users[indx]] |= window_user_mark;
+
+		// round robin over the lanes, a finished lane takes the next payment
+		std::size_t next = 0, running = 0;
+		do {
+			for (std::size_t indx = 0; indx < lanes.size(); indx++) {
+				lane& l = lanes[indx];
+				if (l.busy && l.task.done()) {
+					finish(l);
+					running--;
+				}
+				if (!l.busy && next < queries.size()) {
+					l.task = search(g, l, queries[next++], max_distance);
+					l.busy = true;
+					running++;
+					searches++;
+				}
+				if (l.busy)
+					l.task.resume();
+			}
+		} while (running > 0);
+	}
+
+	// the distance searched for the indx-th payment of the window, before any insertion
+	int searched_distance(std::size_t indx) const { return queries[indx].distance; }
+
+	// an edge was inserted while scoring the window
+	void edge_added(std::size_t a, std::size_t b) {
+		if (!queries.empty())
+			inserted.push_back(std::make_pair(a, b));
+	}
+
+	// the distance between source and target (max_distance + 1 beyond it) searched for the
+	// window, false when the pair was not searched or a new edge may change it
+	template <typename Graph>
+	bool answer(const Graph& g, std::size_t source, std::size_t target, int& distance) {
+		std::unordered_map<uint64_t, std::size_t>::const_iterator it = by_pair.find(key(source, target));
+		if (it == by_pair.end())
+			it = by_pair.find(key(target, source));
+		if (it == by_pair.end())
+			return false;
+		const query& q = queries[it->second];
+		for (std::size_t indx = 0; indx < inserted.size(); indx++) {
+			std::size_t a = inserted[indx].first, b = inserted[indx].second;
+			if (may_shorten(g, q, a, b) || may_shorten(g, q, b, a)) {
+				fallbacks++;
+				return false;
+			}
+		}
+		distance = q.distance;
+		answers++;
+		return true;
+	}
+
+	unsigned long interleaved_searches() const { return searches; }
+	unsigned long interleaved_answers() const { return answers; }
+	unsigned long interleaved_fallbacks() const { return fallbacks; }
+};
+
+#endif /* INTERLEAVED_BFS_H_ */
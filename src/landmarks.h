@@ -0,0 +1,186 @@
+/*
+ * landmarks.h
+ *
+ * Landmark distance bounds (ALT). The distances from a few well connected
+ * landmark vertices to every vertex give, through the triangle inequality,
+ * a lower bound of the distance between any two users:
+ *   d(u,v) >= max over landmarks L of |d(L,u) - d(L,v)|
+ * A bound above the 4th degree answers a payment without any search, and
+ * inside the bounded search it prunes vertices that cannot reach the target
+ * within the remaining budget.
+ * REF: Goldberg, Harrelson, "Computing the Shortest Path: A* Search Meets Graph Theory" (SODA 2005)
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef LANDMARKS_H_
+#define LANDMARKS_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "thread_pool.h"
+
+/* Distances are stored as bytes, vertex major (the distances of a vertex to
+ * all landmarks share a cache line, a bound costs two cache misses). A
+ * distance that does not fit is capped at 254, which keeps the bound valid
+ * since capping never increases |d(L,u) - d(L,v)|, and 255 marks a vertex
+ * the landmark cannot reach.
+ */
+const uint8_t landmark_unreachable = 255;
+const uint8_t landmark_max_distance = 254;
+
+class landmark_index {
+private:
+	unsigned count;
+	std::vector<std::size_t> landmarks;
+	std::vector<uint8_t> dist; // dist[v * count + l]
+
+	static uint8_t next_distance(uint8_t d) {
+		return d >= landmark_max_distance ? landmark_max_distance : d + 1;
+	}
+
+	// full breadth first search from a landmark, distances capped to a byte
+	template <typename Graph>
+	static void bfs(const Graph& g, std::size_t landmark, std::vector<uint8_t>& d) {
+		d.assign(num_vertices(g), landmark_unreachable);
+		std::vector<std::size_t> queue;
+		queue.reserve(num_vertices(g));
+		d[landmark] = 0;
+		queue.push_back(landmark);
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (std::size_t head = 0; head < queue.size(); head++) {
+			std::size_t x = queue[head];
+			for (boost::tie(vi, vi_end) = adjacent_vertices(x, g); vi != vi_end; ++vi) {
+				if (d[*vi] == landmark_unreachable) {
+					d[*vi] = next_distance(d[x]);
+					queue.push_back(*vi);
+				}
+			}
+		}
+	}
+
+	// lowers the distances of landmark l around the vertex v whose distance just dropped
+	template <typename Graph>
+	void propagate(const Graph& g, unsigned l, std::size_t v) {
+		std::deque<std::size_t> queue(1, v);
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		while (!queue.empty()) {
+			std::size_t x = queue.front();
+			queue.pop_front();
+			uint8_t dy = next_distance(dist[x * count + l]);
+			for (boost::tie(vi, vi_end) = adjacent_vertices(x, g); vi != vi_end; ++vi) {
+				uint8_t& d = dist[*vi * count + l];
+				if (dy < d) {
+					d = dy;
+					queue.push_back(*vi);
+				}
+			}
+		}
+	}
+public:
+	landmark_index() : count(0) {}
+
+	// picks the highest degree vertices as landmarks (skipping the neighbours of
+	// those already picked, to spread them over the network) and computes their
+	// distances to every vertex, one landmark per pool task
+	template <typename Graph>
+	void build(const Graph& g, unsigned wanted, thread_pool& pool) {
+		std::size_t n = num_vertices(g);
+		std::vector<std::pair<std::size_t, std::size_t> > by_degree(n);
+		for (std::size_t v = 0; v < n; v++)
+			by_degree[v] = std::make_pair(out_degree(v, g), v);
+		std::sort(by_degree.rbegin(), by_degree.rend());
+
+		std::vector<bool> covered(n, false);
+		landmarks.clear();
+		typename boost::graph_traits<Graph>::adjacency_iterator vi, vi_end;
+		for (std::size_t indx = 0; indx < n && landmarks.size() < wanted; indx++) {
+			std::size_t v = by_degree[indx].second;
+			if (covered[v])
+				continue;
+			landmarks.push_back(v);
+			covered[v] = true;
+			for (boost::tie(vi, vi_end) = adjacent_vertices(v, g); vi != vi_end; ++vi)
+				covered[*vi] = true;
+		}
+		count = landmarks.size();
+
+		std::vector<std::vector<uint8_t> > columns(count);
+		pool.parallel_for(0, count, 1, [&](std::size_t first, std::size_t last, unsigned worker) {
+			for (std::size_t l = first; l < last; l++)
+				bfs(g, landmarks[l], columns[l]);
+		});
+
+		dist.assign(n * count, landmark_unreachable);
+		pool.parallel_for(0, n, 4096, [&](std::size_t first, std::size_t last, unsigned worker) {
+			for (std::size_t v = first; v < last; v++)
+				for (unsigned l = 0; l < count; l++)
+					dist[v * count + l] = columns[l][v];
+		});
+	}
+
+	// a vertex added to the graph is unreachable from every landmark
+	void add_vertex(std::size_t v) {
+		if ((v + 1) * count > dist.size())
+			dist.resize((v + 1) * count, landmark_unreachable);
+	}
+
+	// refreshes the distances after the edge (a, b) was added: distances only decrease,
+	// and only around the endpoint that got closer to a landmark
+	template <typename Graph>
+	void add_edge(std::size_t a, std::size_t b, const Graph& g) {
+		for (unsigned l = 0; l < count; l++) {
+			uint8_t& da = dist[a * count + l];
+			uint8_t& db = dist[b * count + l];
+			if (da != landmark_unreachable && next_distance(da) < db) {
+				db = next_distance(da);
+				propagate(g, l, b);
+			} else if (db != landmark_unreachable && next_distance(db) < da) {
+				da = next_distance(db);
+				propagate(g, l, a);
+			}
+		}
+	}
+
+	// lower bound of the distance between u and v, max_distance + 1 when it exceeds
+	// max_distance (in particular when the landmarks prove u and v disconnected)
+	int lower_bound(std::size_t u, std::size_t v, int max_distance) const {
+		const uint8_t* du = &dist[u * count];
+		const uint8_t* dv = &dist[v * count];
+		int bound = 0;
+		for (unsigned l = 0; l < count; l++) {
+			if (du[l] == landmark_unreachable || dv[l] == landmark_unreachable) {
+				if (du[l] != dv[l])
+					return max_distance + 1; // one of them is in the landmark's component, the other is not
+				continue;
+			}
+			int diff = std::abs((int) du[l] - (int) dv[l]);
+			if (diff > bound)
+				bound = diff;
+		}
+		return bound > max_distance ? max_distance + 1 : bound;
+	}
+
+	// upper bound of the distance between u and v through the closest landmark, max_distance + 1
+	// when no landmark reaches both of them within max_distance
+	int upper_bound(std::size_t u, std::size_t v, int max_distance) const {
+		const uint8_t* du = &dist[u * count];
+		const uint8_t* dv = &dist[v * count];
+		int bound = max_distance + 1;
+		for (unsigned l = 0; l < count; l++)
+			if (du[l] != landmark_unreachable && dv[l] != landmark_unreachable)
+				bound = std::min(bound, (int) du[l] + (int) dv[l]);
+		return bound;
+	}
+
+	unsigned size() const { return count; }
+	std::size_t memory() const { return dist.capacity(); }
+};
+
+#endif /* LANDMARKS_H_ */
@@ -0,0 +1,89 @@
+/*
+ * latency_histogram.h
+ *
+ * Log-linear latency histogram. Every power of two range of nanoseconds is
+ * split into sub_buckets linear buckets, so any recorded value is known to
+ * within 1/sub_buckets of itself whatever its magnitude, in a fixed table of
+ * a few KB. Used for the queue delay and sojourn time of the service mode.
+ * REF: Tene, HdrHistogram (http://hdrhistogram.org)
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <stdint.h>
+
+const unsigned sub_bucket_bits = 4; // 16 linear buckets per power of two
+const unsigned sub_buckets = 1 << sub_bucket_bits;
+const unsigned magnitudes = 64 - sub_bucket_bits;
+
+class latency_histogram {
+private:
+	std::vector<uint64_t> counts;
+	uint64_t total;
+	uint64_t largest;
+	double sum;
+
+	static unsigned bucket(uint64_t ns) {
+		if (ns < sub_buckets)
+			return ns;
+		unsigned magnitude = 63 - __builtin_clzll(ns) - sub_bucket_bits; // sub_buckets <= ns >> magnitude < 2 * sub_buckets
+		return magnitude * sub_buckets + (unsigned) (ns >> magnitude);
+	}
+
+	// the largest value falling in the bucket
+	static uint64_t bucket_value(unsigned indx) {
+		if (indx < 2 * sub_buckets)
+			return indx;
+		unsigned magnitude = indx / sub_buckets - 1;
+		uint64_t first = (uint64_t) (indx - magnitude * sub_buckets) << magnitude;
+		return first + ((uint64_t) 1 << magnitude) - 1;
+	}
+public:
+	latency_histogram() : counts((magnitudes + 2) * sub_buckets, 0), total(0), largest(0), sum(0) {}
+
+	void record(uint64_t ns) {
+		counts[bucket(ns)]++;
+		total++;
+		largest = std::max(largest, ns);
+		sum += ns;
+	}
+
+	void record(std::chrono::steady_clock::duration elapsed) {
+		long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+		record((uint64_t) std::max(0LL, ns));
+	}
+
+	void clear() {
+		std::fill(counts.begin(), counts.end(), 0);
+		total = 0;
+		largest = 0;
+		sum = 0;
+	}
+
+	uint64_t count() const { return total; }
+	uint64_t max() const { return largest; }
+	double mean() const { return total > 0 ? sum / total : 0; }
+
+	// value (ns) below which the given fraction of the recorded values fall
+	uint64_t percentile(double fraction) const {
+		if (total == 0)
+			return 0;
+		uint64_t rank = (uint64_t) (fraction * total);
+		uint64_t seen = 0;
+		for (unsigned indx = 0; indx < counts.size(); indx++) {
+			seen += counts[indx];
+			if (seen > rank)
+				return std::min(largest, bucket_value(indx));
+		}
+		return largest;
+	}
+};
+
+#endif /* LATENCY_HISTOGRAM_H_ */
@@ -0,0 +1,71 @@
+/*
+ * memory_budget.h
+ *
+ * Memory accounting of the scorer. Every large structure registers how to
+ * measure itself under a name, the budget adds them up against the configured
+ * limit, and the report lists them next to the resident set size the kernel
+ * sees (which also holds the allocator's slack and the program itself).
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef MEMORY_BUDGET_H_
+#define MEMORY_BUDGET_H_
+
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// bytes of a node based std::map holding entries (three links and the colour)
+template <typename Map>
+inline std::size_t tree_memory(const Map& map) {
+	return map.size() * (sizeof(typename Map::value_type) + 4 * sizeof(void*));
+}
+
+class memory_budget {
+private:
+	struct account {
+		std::string name;
+		std::function<std::size_t()> bytes;
+	};
+	std::vector<account> accounts;
+	std::size_t budget;
+public:
+	explicit memory_budget(std::size_t budget) : budget(budget) {}
+
+	void track(const std::string& name, std::function<std::size_t()> bytes) {
+		account a = { name, bytes };
+		accounts.push_back(a);
+	}
+
+	std::size_t limit() const { return budget; }
+
+	std::size_t total() const {
+		std::size_t bytes = 0;
+		for (std::size_t indx = 0; indx < accounts.size(); indx++)
+			bytes += accounts[indx].bytes();
+		return bytes;
+	}
+
+	// resident set size of the process, 0 where /proc is not available
+	static std::size_t resident() {
+		std::ifstream statm("/proc/self/statm");
+		std::size_t pages = 0, resident_pages = 0;
+		if (!(statm >> pages >> resident_pages))
+			return 0;
+		return resident_pages * sysconf(_SC_PAGESIZE);
+	}
+
+	void report(std::ostream& os) const {
+		for (std::size_t indx = 0; indx < accounts.size(); indx++)
+			os << "  " << accounts[indx].name << ": " << accounts[indx].bytes() / 1024 << " KB\n";
+		os << "  total " << total() / 1024 << " KB of a " << budget / 1024 << " KB budget, resident set "
+				<< resident() / 1024 << " KB\n";
+	}
+};
+
+#endif /* MEMORY_BUDGET_H_ */
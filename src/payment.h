@@ -0,0 +1,331 @@
+/*
+ * payment.h
+ *
+ * PayMo payment records and the CSV reader shared by the fraud alert
+ * programs. A record consists of five fields separated by commas:
+ * time, id1, id2, amount, message
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef PAYMENT_H_
+#define PAYMENT_H_
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+// how the scorer treats a payment, lowered by the admission stage of the service mode
+// when the payment waited in the queue beyond the latency objective
+enum scoring_mode {
+	score_full, // friendship degree established by a search
+	score_cheap, // direct friendship and connected components only
+	score_rejected // not scored at all
+};
+
+// payment struct is modeled after PayMo payment records
+// a record consists of five fields separated by commas:
+// time, id1, id2, amount, message
+// 2016-11-02 09:49:29, 52575, 1120, 25.32, Spam
+typedef struct {
+	std::string time; // the timestamp is being stored as a string.
+	long epoch; // the timestamp in seconds since 1970-01-01 (used to order streams)
+	int id1; // validated by parse_record, the lenient reader casts without input validation
+	int id2; // validated by parse_record, the lenient reader casts without input validation
+	std::string amount; // since we are not using amount we keep it as a string
+	std::string message;
+	bool duplicate; // set by the dedup stage on a repeated record
+	bool malformed; // a line refused by the strict reader, kept in the stream for its verdict line
+	scoring_mode scoring; // set by the admission stage under overload
+} payment_t;
+
+typedef std::vector<payment_t> data_t;
+
+// returned by parse_timestamp whenever the time field is not a PayMo timestamp
+const long invalid_epoch = -1;
+
+// days since 1970-01-01 of a proleptic gregorian date
+// REF: http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+inline long days_from_civil(long y, unsigned m, unsigned d) {
+	y -= m <= 2;
+	const long era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned yoe = (unsigned) (y - era * 400);
+	const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + (long) doe - 719468;
+}
+
+// the proleptic gregorian date of a day count since 1970-01-01
+// REF: http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+inline void civil_from_days(long z, long& y, unsigned& m, unsigned& d) {
+	z += 719468;
+	const long era = (z >= 0 ? z : z - 146096) / 146097;
+	const unsigned doe = (unsigned) (z - era * 146097);
+	const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const unsigned mp = (5 * doy + 2) / 153;
+	d = doy - (153 * mp + 2) / 5 + 1;
+	m = mp < 10 ? mp + 3 : mp - 9;
+	y = (long) yoe + era * 400 + (m <= 2);
+}
+
+// converts seconds since the epoch back into a "2016-11-02 09:49:29" timestamp
+inline std::string format_timestamp(long epoch) {
+	long days = (epoch >= 0 ? epoch : epoch - 86399) / 86400;
+	long seconds = epoch - days * 86400;
+	long year;
+	unsigned month, day;
+	civil_from_days(days, year, month, day);
+	char text[64];
+	std::snprintf(text, sizeof(text), "%04ld-%02u-%02u %02ld:%02ld:%02ld", year, month, day,
+			seconds / 3600, seconds / 60 % 60, seconds % 60);
+	return text;
+}
+
+// converts a "2016-11-02 09:49:29" timestamp into seconds since the epoch.
+// the timestamps are written in a fixed width format, so instead of going
+// through strptime/timegm (locale and timezone lookups) the digits are read in place.
+inline long parse_timestamp(const std::string& time) {
+	std::string::size_type pos = time.find_first_not_of(' ');
+	if (pos == std::string::npos || time.size() - pos < 19)
+		return invalid_epoch;
+	const char* s = time.c_str() + pos;
+	static const int digits[] = { 0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 17, 18 };
+	for (unsigned i = 0; i < sizeof(digits) / sizeof(digits[0]); i++)
+		if (s[digits[i]] < '0' || s[digits[i]] > '9')
+			return invalid_epoch;
+	long year = (s[0] - '0') * 1000 + (s[1] - '0') * 100 + (s[2] - '0') * 10 + (s[3] - '0');
+	unsigned month = (s[5] - '0') * 10 + (s[6] - '0');
+	unsigned day = (s[8] - '0') * 10 + (s[9] - '0');
+	long hour = (s[11] - '0') * 10 + (s[12] - '0');
+	long minute = (s[14] - '0') * 10 + (s[15] - '0');
+	long second = (s[17] - '0') * 10 + (s[18] - '0');
+	return days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+// why the strict reader refused a record line
+enum record_fault {
+	record_valid,
+	fault_fields, // fewer than five comma separated fields
+	fault_timestamp, // not a "2016-11-02 09:49:29" timestamp of an existing date and time
+	fault_id, // an id that is not a non-negative integer fitting an int
+	fault_amount // an amount that is not a decimal number with at most two decimals
+};
+
+const char* const record_fault_names[] = { "valid", "field count", "timestamp", "id", "amount" };
+
+inline bool is_blank(char c) { return c == ' ' || c == '\t'; }
+
+inline const char* skip_blanks(const char* at, const char* end) {
+	while (at < end && is_blank(*at))
+		at++;
+	return at;
+}
+
+inline bool is_digit(char c) { return (unsigned) (c - '0') <= 9; }
+
+// the strict reader scans a line once, field after field; the characters of a field are
+// tested together (a timestamp with three word-wide range checks, a number by the length
+// of its run of digits) and a field is only refused once it has been scanned entirely
+
+// the bytes of a word outside their ranges [low, high], all of them below 0x80: every byte
+// of the result has its high bit set when the corresponding byte is out of range
+inline uint64_t bytes_out_of_range(uint64_t word, uint64_t low, uint64_t high) {
+	const uint64_t top = 0x8080808080808080ULL;
+	uint64_t below = ~((word | top) - low) & top; // (b | 0x80) - low keeps the top bit iff b >= low
+	uint64_t above = ((word & ~top) + (~high & ~top)) & top; // b + (0x7f - high) reaches it iff b > high
+	return below | above | (word & top);
+}
+
+inline uint64_t load_word(const char* at) {
+	uint64_t word;
+	std::memcpy(&word, at, sizeof(word));
+	return word;
+}
+
+// a "2016-11-02 09:49:29" timestamp of an existing date and time, blanks around it; at is left
+// on the character after them. Returns the seconds since the epoch, invalid_epoch if refused
+inline long scan_timestamp(const char*& at, const char* end) {
+	at = skip_blanks(at, end);
+	if (end - at < 19)
+		return invalid_epoch;
+	static const char low[] = "0000-00-00 00:00:00";
+	static const char high[] = "9999-99-99 99:99:99";
+	const char* s = at;
+	uint64_t bad = bytes_out_of_range(load_word(s), load_word(low), load_word(high))
+			| bytes_out_of_range(load_word(s + 8), load_word(low + 8), load_word(high + 8))
+			| bytes_out_of_range(load_word(s + 11), load_word(low + 11), load_word(high + 11));
+	long year = (s[0] - '0') * 1000 + (s[1] - '0') * 100 + (s[2] - '0') * 10 + (s[3] - '0');
+	unsigned month = (s[5] - '0') * 10 + (s[6] - '0');
+	unsigned day = (s[8] - '0') * 10 + (s[9] - '0');
+	unsigned hour = (s[11] - '0') * 10 + (s[12] - '0');
+	unsigned minute = (s[14] - '0') * 10 + (s[15] - '0');
+	unsigned second = (s[17] - '0') * 10 + (s[18] - '0');
+	static const unsigned month_days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	unsigned days = month_days[(month - 1) % 12]
+			+ (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
+	bad |= (month - 1 > 11) | (day - 1 >= days) | (hour > 23) | (minute > 59) | (second > 59);
+	at = skip_blanks(at + 19, end);
+	if (bad)
+		return invalid_epoch;
+	return days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+// a non-negative int of 1 to 10 digits, blanks around it; -1 if refused
+inline long scan_id(const char*& at, const char* end) {
+	at = skip_blanks(at, end);
+	const char* first = at;
+	unsigned long value = 0;
+	while (at < end && is_digit(*at))
+		value = value * 10 + (*at++ - '0');
+	std::size_t digits = at - first;
+	at = skip_blanks(at, end);
+	return (digits - 1 > 9) | (value > INT_MAX) ? -1 : (long) value;
+}
+
+// digits, optionally followed by a point and one or two digits, blanks around them
+inline bool scan_amount(const char*& at, const char* end) {
+	at = skip_blanks(at, end);
+	const char* first = at;
+	while (at < end && is_digit(*at))
+		at++;
+	std::size_t whole = at - first;
+	std::size_t decimals = 1;
+	if (at < end && *at == '.') {
+		const char* point = ++at;
+		while (at < end && is_digit(*at))
+			at++;
+		decimals = at - point;
+	}
+	at = skip_blanks(at, end);
+	return (whole > 0) & (decimals - 1 <= 1);
+}
+
+// the comma closing a field, at is left on the next field
+inline bool scan_comma(const char*& at, const char* end) {
+	bool found = at < end && *at == ',';
+	at += found;
+	return found;
+}
+
+// the fault of a refused line: the field refused, unless the line lacks fields altogether
+inline record_fault refused(const char* begin, const char* end, record_fault fault) {
+	return std::count(begin, end, ',') < 4 ? fault_fields : fault;
+}
+
+// the strict reader of a record line: every field is checked before the record is filled,
+// a line refused is left to the caller (the message is free text and may hold commas)
+inline record_fault parse_record(const std::string& line, payment_t& record) {
+	const char* begin = line.data();
+	const char* end = begin + line.size();
+	const char* at = begin;
+	long epoch = scan_timestamp(at, end);
+	const char* time_end = at;
+	if (epoch == invalid_epoch || !scan_comma(at, end))
+		return refused(begin, end, fault_timestamp);
+	long id1 = scan_id(at, end);
+	if (id1 < 0 || !scan_comma(at, end))
+		return refused(begin, end, fault_id);
+	long id2 = scan_id(at, end);
+	if (id2 < 0 || !scan_comma(at, end))
+		return refused(begin, end, fault_id);
+	const char* amount_begin = at;
+	bool amount = scan_amount(at, end);
+	const char* amount_end = at;
+	if (!amount || !scan_comma(at, end))
+		return refused(begin, end, fault_amount);
+	record.time.assign(begin, time_end);
+	record.epoch = epoch;
+	record.id1 = id1;
+	record.id2 = id2;
+	record.amount.assign(amount_begin, amount_end);
+	record.message.assign(at, end);
+	record.duplicate = false;
+	record.malformed = false;
+	record.scoring = score_full;
+	return record_valid;
+}
+
+// the lenient reader of a record line: whatever the fields hold, a record comes out of it
+inline void parse_record_leniently(const std::string& line, payment_t& record) {
+	// separating the comma delimited values out of the line
+	std::stringstream ss(line);
+	std::string id1_field, id2_field;
+	std::getline(ss, record.time, ',');
+	std::getline(ss, id1_field, ',');
+	std::getline(ss, id2_field, ',');
+	std::getline(ss, record.amount, ',');
+	std::getline(ss, record.message);
+
+	std::stringstream id1fss(id1_field);
+	std::stringstream id2fss(id2_field);
+	id1fss >> record.id1;
+	id2fss >> record.id2;
+	record.epoch = parse_timestamp(record.time);
+	record.duplicate = false;
+	record.malformed = false;
+	record.scoring = score_full;
+}
+
+// overloading input stream operator to read a single PayMo batch_payment record
+inline std::istream& operator >>(std::istream& is, payment_t& record) {
+
+	// the entire payment record is first read into a string and then parsed out
+	// NOTE: each payment record occupies a line and values are separated by comma
+	std::string line;
+	std::getline(is, line);
+
+	// a well formed line takes the strict reader, which reads it the same way without the
+	// string streams, any other line is read leniently as it always was
+	if (parse_record(line, record) != record_valid)
+		parse_record_leniently(line, record);
+	return is;
+}
+
+// overloading the input stream operator to read a list of PayMo payment records
+inline std::istream& operator >>(std::istream& is, data_t& data) {
+	// since we reuse our payment database, both for the batch_payment and stream_payment
+	// we clear the database every time we read a new payment file.
+	data.clear();
+
+	// removing the first line of the payment CSV file (PayMo header)
+	std::string header_line;
+	std::getline(is, header_line);
+
+	// Reading records from file and appending them to the payment database
+	payment_t record;
+	while (is >> record) {
+		data.push_back(record);
+	}
+
+	return is;
+}
+
+// overloading the output stream operator to write a payment back as a PayMo CSV record
+// (the amount and message fields keep the blank that follows the comma in the input)
+inline std::ostream& operator <<(std::ostream& os, const payment_t& record) {
+	return os << record.time << ", " << record.id1 << ", " << record.id2 << ","
+			<< record.amount << "," << record.message;
+}
+
+// a payment_source hands out payment records one at a time, in the order
+// in which they should be scored. Sources can be chained (e.g. a merge of
+// several feeds followed by a reorder stage) since each stage only pulls
+// from the previous one.
+class payment_source {
+public:
+	virtual ~payment_source() {}
+
+	// fetches the next payment record, returns false once the source is exhausted
+	virtual bool next(payment_t& payment) = 0;
+};
+
+#endif /* PAYMENT_H_ */
@@ -0,0 +1,89 @@
+/*
+ * paymo-convert.cpp
+ *
+ * Converts PayMo payment files between the CSV text format and the fixed
+ * width binary records of binary_payments.h, in either direction:
+ *
+ *   paymo-convert batch_payment.csv batch_payment.bin
+ *   paymo-convert --to-csv batch_payment.bin batch_payment.csv
+ *
+ * The scorer reads both formats wherever it takes a payment file. Amounts
+ * are stored in cents (rounded), so "25.3" and "25.30" convert back alike.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "binary_payments.h"
+#include "payment.h"
+
+using namespace std;
+
+void print_usage(const char* program) {
+	cout << "Usage: " << program << " [--to-csv] input output\n"
+			<< "Converts a CSV payment file into binary records, or binary records back into CSV.\n";
+}
+
+int main(int argc, char* argv[]) {
+	bool to_csv = false;
+	vector<string> positional;
+	for (int indx = 1; indx < argc; indx++) {
+		string arg = argv[indx];
+		if (arg == "--to-csv")
+			to_csv = true;
+		else if (arg.compare(0, 2, "--") == 0) {
+			print_usage(argv[0]);
+			return 1;
+		} else
+			positional.push_back(arg);
+	}
+	if (positional.size() != 2) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (to_csv) {
+		binary_payment_file input;
+		if (!input.open(positional[0])) {
+			cout << "Error while reading the binary payment file " << positional[0] << ". Aborting.\n";
+			return 1;
+		}
+		ofstream output(positional[1].c_str());
+		output << "time, id1, id2, amount, message\n";
+		payment_t payment;
+		for (size_t indx = 0; indx < input.size(); indx++) {
+			input.get(indx, payment);
+			output << payment << "\n";
+		}
+		output.close();
+		if (!output) {
+			cout << "Error while writing " << positional[1] << ". Aborting.\n";
+			return 1;
+		}
+		cout << input.size() << " payments converted to CSV.\n";
+		return 0;
+	}
+
+	ifstream input(positional[0].c_str());
+	binary_payment_writer output;
+	if (!input.is_open() || !output.open(positional[1])) {
+		cout << "Error while opening " << positional[0] << " or " << positional[1] << ". Aborting.\n";
+		return 1;
+	}
+	// records are converted as they are read, the header line is skipped
+	string header_line;
+	getline(input, header_line);
+	payment_t payment;
+	while (input >> payment)
+		output.write(payment);
+	if (!input.eof() || !output.close()) {
+		cout << "Error while converting " << positional[0] << ". Aborting.\n";
+		return 1;
+	}
+	cout << output.records() << " payments converted to binary records.\n";
+	return 0;
+}
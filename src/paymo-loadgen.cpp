@@ -0,0 +1,238 @@
+/*
+ * paymo-loadgen.cpp
+ *
+ * Open loop load generator for the fraud alert scorer. The payments of a
+ * CSV file are replayed into the scorer's stream FIFO at a fixed rate, and
+ * the verdicts are read back from its first output FIFO, in order, one
+ * line per payment:
+ *
+ *   mkfifo /tmp/stream.fifo /tmp/output1.fifo
+ *   fraud-alert-bfs batch_payment.csv /tmp/stream.fifo /tmp/output1.fifo out2.txt out3.txt &
+ *   paymo-loadgen --rate=5000 --duration=30 stream_payment.csv /tmp/stream.fifo /tmp/output1.fifo
+ *
+ * Sends follow a fixed timeline (payment i is due at start + i / rate), and
+ * a late send never shifts the ones after it. The latency of a payment runs
+ * from its intended send time to its verdict: when the scorer stalls, the
+ * payments that should have been sent meanwhile are charged for the stall
+ * instead of being silently left out (coordinated omission). The latency
+ * from the actual send time is reported alongside for comparison.
+ * REF: Tene, "How NOT to Measure Latency" (Strange Loop 2015)
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "latency_histogram.h"
+#include "payment.h"
+
+using namespace std;
+
+typedef chrono::steady_clock::time_point time_point;
+
+typedef struct {
+	string input_path;
+	string stream_path;
+	string verdict_path;
+	string record_path; // the verdicts read back are also written there, empty for none
+	double rate; // payments per second
+	double duration; // seconds of offered load, 0 sends the input once
+	size_t warmup; // first payments left out of the histograms
+} config_t;
+
+void print_usage(const char* program) {
+	cout << "Usage: " << program << " [options] stream_payment stream_fifo verdict_fifo\n"
+			<< "Replays the payments of stream_payment into the scorer's stream_fifo at a fixed rate\n"
+			<< "and reads a verdict per payment back from verdict_fifo (its first output file).\n"
+			<< "Options:\n"
+			<< "  --rate=PAYMENTS       payments offered per second (default: 1000)\n"
+			<< "  --duration=SECONDS    seconds of offered load, the input is replayed in a loop\n"
+			<< "                        (default: the input is sent once)\n"
+			<< "  --warmup=PAYMENTS     first payments left out of the latency report (default: 0)\n"
+			<< "  --record=FILE         also write the verdicts read back to FILE, one line per payment\n";
+}
+
+bool parse_arguments(int argc, char* argv[], config_t& config) {
+	config.rate = 1000;
+	config.duration = 0;
+	config.warmup = 0;
+	vector<string> positional;
+	for (int indx = 1; indx < argc; indx++) {
+		string arg = argv[indx];
+		if (arg.compare(0, 7, "--rate=") == 0 && atof(arg.c_str() + 7) > 0)
+			config.rate = atof(arg.c_str() + 7);
+		else if (arg.compare(0, 11, "--duration=") == 0)
+			config.duration = atof(arg.c_str() + 11);
+		else if (arg.compare(0, 9, "--warmup=") == 0)
+			config.warmup = strtoul(arg.c_str() + 9, 0, 10);
+		else if (arg.compare(0, 9, "--record=") == 0 && arg.size() > 9)
+			config.record_path = arg.substr(9);
+		else if (arg.compare(0, 2, "--") == 0)
+			return false;
+		else
+			positional.push_back(arg);
+	}
+	if (positional.size() != 3)
+		return false;
+	config.input_path = positional[0];
+	config.stream_path = positional[1];
+	config.verdict_path = positional[2];
+	return true;
+}
+
+// creates the FIFO unless the path already exists
+bool make_fifo(const string& path) {
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0)
+		return true;
+	return mkfifo(path.c_str(), 0600) == 0;
+}
+
+bool write_all(int fd, const string& text) {
+	const char* data = text.data();
+	size_t left = text.size();
+	while (left > 0) {
+		ssize_t written = write(fd, data, left);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+		data += written;
+		left -= written;
+	}
+	return true;
+}
+
+void print_latencies(const string& name, const latency_histogram& latencies) {
+	const double fractions[] = { 0.5, 0.9, 0.99, 0.999, 0.9999 };
+	cout << left << setw(22) << name << right << fixed << setprecision(3);
+	for (unsigned indx = 0; indx < 5; indx++)
+		cout << setw(12) << latencies.percentile(fractions[indx]) / 1e6;
+	cout << setw(12) << latencies.max() / 1e6 << "\n";
+}
+
+int main(int argc, char* argv[]) {
+	config_t config;
+	if (!parse_arguments(argc, argv, config)) {
+		print_usage(argv[0]);
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN); // a scorer going away shows up as a failed write
+
+	data_t payments;
+	ifstream input(config.input_path.c_str());
+	input >> payments;
+	if (!input.eof() || payments.empty()) {
+		cout << "Error while reading the payment file " << config.input_path << ". Aborting.\n";
+		return 1;
+	}
+	// the records are formatted up front, the sender only copies them out
+	vector<string> records(payments.size());
+	for (size_t indx = 0; indx < payments.size(); indx++) {
+		stringstream record;
+		record << payments[indx] << "\n";
+		records[indx] = record.str();
+	}
+	size_t total = config.duration > 0 ? (size_t) (config.rate * config.duration) : payments.size();
+
+	ofstream record;
+	if (!config.record_path.empty()) {
+		record.open(config.record_path.c_str());
+		if (!record.is_open()) {
+			cout << "Error while creating the record file " << config.record_path << ". Aborting.\n";
+			return 1;
+		}
+	}
+
+	if (!make_fifo(config.stream_path) || !make_fifo(config.verdict_path)) {
+		cout << "Error while creating the FIFOs. Aborting.\n";
+		return 1;
+	}
+	cout << "Waiting for the scorer on " << config.stream_path << " and " << config.verdict_path << "...\n";
+	int stream = open(config.stream_path.c_str(), O_WRONLY);
+	if (stream < 0 || !write_all(stream, "time, id1, id2, amount, message\n")) {
+		cout << "Error while opening " << config.stream_path << ". Aborting.\n";
+		return 1;
+	}
+	ifstream verdicts(config.verdict_path.c_str());
+	if (!verdicts.is_open()) {
+		cout << "Error while opening " << config.verdict_path << ". Aborting.\n";
+		return 1;
+	}
+
+	// the sender publishes how many payments it wrote, the receiver never reads ahead of it
+	vector<time_point> intended(total), actual(total);
+	atomic<size_t> sent(0);
+	chrono::steady_clock::duration worst_lag(0);
+	time_point start = chrono::steady_clock::now();
+	thread sender([&] {
+		for (size_t indx = 0; indx < total; indx++) {
+			intended[indx] = start + chrono::duration_cast<chrono::steady_clock::duration>(
+					chrono::duration<double>(indx / config.rate));
+			this_thread::sleep_until(intended[indx]);
+			actual[indx] = chrono::steady_clock::now();
+			worst_lag = max(worst_lag, actual[indx] - intended[indx]);
+			// published before the write: a fast scorer may answer before write_all returns
+			sent.store(indx + 1, memory_order_release);
+			if (!write_all(stream, records[indx % records.size()])) {
+				sent.store(indx, memory_order_release);
+				break;
+			}
+		}
+		close(stream); // end of the stream, the scorer drains and exits
+	});
+
+	latency_histogram corrected, uncorrected;
+	size_t received = 0;
+	string line;
+	while (getline(verdicts, line)) {
+		time_point now = chrono::steady_clock::now();
+		if (received >= sent.load(memory_order_acquire)) {
+			cout << "Error: more verdicts than payments sent. Aborting.\n";
+			break;
+		}
+		if (received >= config.warmup) {
+			corrected.record(now - intended[received]);
+			uncorrected.record(now - actual[received]);
+		}
+		if (record.is_open())
+			record << line << "\n";
+		received++;
+	}
+	sender.join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << sent.load() << " payments offered at " << fixed << setprecision(0) << config.rate << "/s, "
+			<< received << " verdicts received in " << setprecision(2) << seconds << " s ("
+			<< setprecision(0) << received / seconds << "/s).\n";
+	cout << "The sender was at most " << setprecision(3)
+			<< chrono::duration<double, milli>(worst_lag).count() << " ms behind its timeline.\n";
+	cout << "\n" << left << setw(22) << "latency (ms)" << right << setw(12) << "p50" << setw(12) << "p90"
+			<< setw(12) << "p99" << setw(12) << "p99.9" << setw(12) << "p99.99" << setw(12) << "max" << "\n";
+	print_latencies("from intended send", corrected);
+	print_latencies("from actual send", uncorrected);
+	if (record.is_open()) {
+		record.close();
+		if (record.fail()) {
+			cout << "Error while writing the record file " << config.record_path << ". Aborting.\n";
+			return 1;
+		}
+	}
+	return received == sent.load() ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/*
+ * perf_counters.h
+ *
+ * Hardware counters of the calling thread through perf_event_open (Linux),
+ * used by the benchmarks to tell memory stalls from useful work. Counters the
+ * CPU, the kernel or the sandbox do not provide are reported as unavailable.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+class perf_counters {
+private:
+	struct counter {
+		std::string name;
+		int fd; // -1 when the event could not be opened
+		uint64_t value;
+	};
+	std::vector<counter> counters;
+
+	void add(const char* name, uint32_t type, uint64_t config) {
+		struct perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		counter c;
+		c.name = name;
+		c.fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		c.value = 0;
+		counters.push_back(c);
+	}
+
+	// perf_event_open has no copy semantics for the descriptors
+	perf_counters(const perf_counters&);
+	perf_counters& operator=(const perf_counters&);
+public:
+	perf_counters() {
+		add("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		add("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		add("stalled-cycles-backend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND);
+		add("cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+		add("L1d-load-misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+				| (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	}
+
+	~perf_counters() {
+		for (std::size_t indx = 0; indx < counters.size(); indx++)
+			if (counters[indx].fd >= 0)
+				close(counters[indx].fd);
+	}
+
+	void start() {
+		for (std::size_t indx = 0; indx < counters.size(); indx++) {
+			if (counters[indx].fd < 0)
+				continue;
+			ioctl(counters[indx].fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(counters[indx].fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+
+	void stop() {
+		for (std::size_t indx = 0; indx < counters.size(); indx++) {
+			counter& c = counters[indx];
+			if (c.fd < 0)
+				continue;
+			ioctl(c.fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(c.fd, &c.value, sizeof(c.value)) != sizeof(c.value))
+				c.value = 0;
+		}
+	}
+
+	std::size_t size() const { return counters.size(); }
+	const std::string& name(std::size_t indx) const { return counters[indx].name; }
+	bool available(std::size_t indx) const { return counters[indx].fd >= 0; }
+	uint64_t value(std::size_t indx) const { return counters[indx].value; }
+};
+
+#endif /* PERF_COUNTERS_H_ */
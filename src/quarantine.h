@@ -0,0 +1,90 @@
+/*
+ * quarantine.h
+ *
+ * Quarantine of malformed payment records. With validation on, every CSV
+ * record line goes through the strict reader of payment.h, and a line it
+ * refuses is neither loaded nor scored: it is written to the quarantine file
+ * with its file name, line number and fault instead, e.g.
+ *
+ *   paymo_input/batch_payment.txt:1234: id: 2016-11-02 09:49:29, 5257x, 1120, 25.32, Spam
+ *
+ * A refused stream line still takes its place in the stream as a malformed
+ * payment, which the scorer answers with a "Malformed" line: the output lines
+ * stay aligned with the stream records. The readers of several files or feeds
+ * may log at the same time.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef QUARANTINE_H_
+#define QUARANTINE_H_
+
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include "payment.h"
+
+class quarantine_log {
+private:
+	std::mutex lock;
+	std::ofstream file;
+	unsigned long count;
+
+	quarantine_log(const quarantine_log&);
+	quarantine_log& operator=(const quarantine_log&);
+public:
+	quarantine_log() : count(0) {}
+
+	bool open(const std::string& path) {
+		file.open(path.c_str());
+		return file.is_open();
+	}
+
+	// logs line number of source, refused for fault
+	void add(const std::string& source, unsigned long number, record_fault fault, const std::string& line) {
+		std::lock_guard<std::mutex> guard(lock);
+		file << source << ":" << number << ": " << record_fault_names[fault] << ": " << line << "\n";
+		count++;
+	}
+
+	// false if any write failed
+	bool close() {
+		file.close();
+		return !file.fail();
+	}
+
+	unsigned long size() {
+		std::lock_guard<std::mutex> guard(lock);
+		return count;
+	}
+};
+
+// reads the record on line number of source: strictly when a quarantine log is given, a
+// refused line is then logged and false returned; leniently otherwise, as operator >> does
+inline bool read_record(const std::string& line, payment_t& record, quarantine_log* quarantine,
+		const std::string& source, unsigned long number) {
+	record_fault fault = parse_record(line, record);
+	if (fault == record_valid)
+		return true;
+	if (!quarantine) {
+		parse_record_leniently(line, record);
+		return true;
+	}
+	quarantine->add(source, number, fault, line);
+	return false;
+}
+
+// the placeholder of a refused stream line, sorted at the time of the record before it
+inline void malformed_record(const std::string& line, long epoch, payment_t& record) {
+	record.time.clear();
+	record.epoch = epoch;
+	record.id1 = record.id2 = 0;
+	record.amount.clear();
+	record.message = line; // keeps placeholders of different lines apart in the dedup stage
+	record.duplicate = false;
+	record.malformed = true;
+	record.scoring = score_full;
+}
+
+#endif /* QUARANTINE_H_ */
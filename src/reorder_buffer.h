@@ -0,0 +1,129 @@
+/*
+ * reorder_buffer.h
+ *
+ * Releases slightly out of order payments in timestamp order. Payments are
+ * held back until the watermark (newest timestamp seen minus the allowed
+ * lateness) passes their second, anything arriving behind the watermark is
+ * a late payment and goes through the configured late_policy.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef REORDER_BUFFER_H_
+#define REORDER_BUFFER_H_
+
+#include <climits>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "payment.h"
+
+// what happens to payments arriving behind the watermark
+enum late_policy {
+	late_score, // released immediately, out of timestamp order
+	late_log // written to the late events log and not scored
+};
+
+/* The buffer is a ring of one-second buckets covering the lateness window
+ * [watermark, newest], so inserting a payment is an append to the bucket of
+ * its second and releasing is a walk over the ring. Memory is bounded by the
+ * payments of lateness+1 seconds and the only per payment overhead is the
+ * record itself. Payments of the same second keep their arrival order.
+ */
+class reorder_buffer : public payment_source {
+private:
+	payment_source& upstream;
+	late_policy policy;
+	std::ostream* late_events;
+	std::vector<data_t> buckets; // bucket of second s lives at s % buckets.size()
+	payment_t held; // payment waiting for room in the ring
+	bool holding;
+	data_t released; // bucket being handed out
+	std::size_t released_pos;
+	long next_second; // oldest second that may still be buffered
+	long closed_until; // seconds below this one are behind the watermark
+	std::size_t buffered;
+	bool exhausted;
+	unsigned long late_count;
+
+	data_t& bucket(long second) {
+		return buckets[(unsigned long) second % buckets.size()];
+	}
+
+	// moves the oldest closed second into the release bucket
+	bool release_closed() {
+		while (next_second < closed_until) {
+			if (buffered == 0) {
+				next_second = closed_until; // nothing buffered, skip the empty seconds
+				return false;
+			}
+			data_t& oldest = bucket(next_second++);
+			if (!oldest.empty()) {
+				released.clear();
+				released.swap(oldest);
+				released_pos = 0;
+				buffered -= released.size();
+				return true;
+			}
+		}
+		return false;
+	}
+public:
+	// the lateness is given in seconds, late payments go to late_events (if any) under late_log
+	reorder_buffer(payment_source& upstream, long lateness, late_policy policy = late_score,
+			std::ostream* late_events = 0) :
+		upstream(upstream), policy(late_events ? policy : late_score), late_events(late_events),
+		buckets(lateness > 0 ? lateness + 1 : 1), holding(false), released_pos(0), next_second(LONG_MIN),
+		closed_until(LONG_MIN), buffered(0), exhausted(false), late_count(0) {}
+
+	unsigned long late_payments() const { return late_count; }
+
+	bool next(payment_t& payment) {
+		while (true) {
+			if (released_pos < released.size()) {
+				payment = std::move(released[released_pos++]);
+				return true;
+			}
+			if (holding) {
+				// the ring only has room for the payment once the seconds behind the watermark are out
+				if (held.epoch - next_second >= (long) buckets.size() && release_closed())
+					continue;
+				bucket(held.epoch).push_back(std::move(held));
+				buffered++;
+				holding = false;
+			}
+			if (release_closed())
+				continue;
+			if (exhausted)
+				return false;
+
+			if (!upstream.next(held)) {
+				// end of the stream, everything still buffered can be released
+				exhausted = true;
+				closed_until = LONG_MAX;
+				continue;
+			}
+
+			long epoch = held.epoch;
+			if (epoch == invalid_epoch || epoch < closed_until) {
+				late_count++;
+				if (policy == late_score) {
+					payment = std::move(held);
+					return true;
+				}
+				*late_events << held << '\n';
+				continue;
+			}
+
+			long lateness = (long) buckets.size() - 1;
+			if (next_second == LONG_MIN)
+				next_second = closed_until = epoch - lateness;
+			if (epoch - lateness > closed_until)
+				closed_until = epoch - lateness; // advancing the watermark
+			holding = true;
+		}
+	}
+};
+
+#endif /* REORDER_BUFFER_H_ */
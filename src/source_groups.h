@@ -0,0 +1,157 @@
+/*
+ * source_groups.h
+ *
+ * Window grouping of stream payments by payer. The payments of a window
+ * that share a payer are answered by a single bounded traversal from it,
+ * run on the network as it was at the start of the window; the payments
+ * are still scored (and their edges inserted) in stream order, and a
+ * saved answer is only used when no edge inserted since can change it.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef SOURCE_GROUPS_H_
+#define SOURCE_GROUPS_H_
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "bounded_bfs.h"
+
+/* A saved answer d0(s, t) is wrong only if a path shorter than d0 uses an
+ * edge inserted during the window. Take the first such edge on the path,
+ * entered at x and left at y: the part before it only uses old edges, so
+ * the path is at least d_old(s, x) + 1 + d(y, t) long. The traversal keeps
+ * d_old(s, x) for every user of the window (the endpoints of every payment
+ * that may insert an edge, see prepare), and d(y, t) is bounded by 1 unless
+ * y = t. That settles every edge away from the payer; for the edges from the
+ * payer itself (its earlier payments of the window) d(y, t) is tested exactly
+ * with the edge and intersection kernels while it has to be at most 2. An
+ * edge from a user outside the window, whose distance was not recorded, and
+ * any other case fall back to a regular search.
+ */
+class source_groups {
+private:
+	struct group {
+		std::unordered_map<std::size_t, int> targets; // target -> distance at the start of the window
+		std::unordered_map<std::size_t, int> known; // window user -> distance at the start of the window
+		int horizon; // lower bound of the distance of the users not in known
+	};
+
+	// records the distances of the window users and targets, stops once every target is found
+	struct group_recording {
+		group& gr;
+		const std::unordered_set<std::size_t>& users;
+		unsigned& missing;
+		int& found_at;
+		bool operator()(std::size_t vertex, int distance) const {
+			if (users.count(vertex))
+				gr.known[vertex] = distance;
+			std::unordered_map<std::size_t, int>::iterator it = gr.targets.find(vertex);
+			if (it != gr.targets.end() && distance < it->second) {
+				it->second = distance;
+				if (--missing == 0)
+					found_at = distance;
+			}
+			return missing == 0;
+		}
+	};
+
+	int max_distance;
+	std::unordered_map<std::size_t, group> groups; // by payer
+	std::unordered_set<std::size_t> users; // the window users, whose distances the traversals record
+	std::vector<std::pair<std::size_t, std::size_t> > inserted; // edges added since the window started
+	unsigned long traversals, answers, fallbacks;
+
+	// whether a path entering the new edge at x and leaving it at y may beat d0
+	template <typename Graph>
+	bool may_shorten(const Graph& g, const group& gr, std::size_t source, std::size_t target, std::size_t x,
+			std::size_t y, int d0) const {
+		std::unordered_map<std::size_t, int>::const_iterator it = gr.known.find(x);
+		if (it == gr.known.end() && !users.count(x))
+			return true; // not a window user: its distance was not recorded, it may be close
+		int dx = it != gr.known.end() ? it->second : gr.horizon;
+		if (dx + 1 + (y == target ? 0 : 1) >= d0)
+			return false;
+		if (x != source || y == target)
+			return true;
+		int slack = d0 - 2; // the path is shorter iff d(y, target) <= slack
+		if (slack > 2)
+			return true;
+		return g.has_edge(y, target) || (slack == 2 && g.intersects(y, target));
+	}
+public:
+	explicit source_groups(int max_distance) : max_distance(max_distance), traversals(0), answers(0), fallbacks(0) {}
+
+	// starts a window: payers with several payments get one traversal answering all of their payees;
+	// window_users are the endpoints of every payment of the window that may insert an edge, searched or not
+	template <typename Graph>
+	void prepare(const Graph& g, bounded_bfs& search, const std::vector<std::pair<std::size_t, std::size_t> >& payments,
+			const std::vector<std::size_t>& window_users) {
+		groups.clear();
+		inserted.clear();
+		std::unordered_map<std::size_t, unsigned> count;
+		users.clear();
+		users.insert(window_users.begin(), window_users.end());
+		for (std::size_t indx = 0; indx < payments.size(); indx++)
+			count[payments[indx].first]++;
+		for (std::size_t indx = 0; indx < payments.size(); indx++) {
+			std::size_t source = payments[indx].first, target = payments[indx].second;
+			if (count[source] > 1)
+				groups[source].targets[target] = source == target ? 0 : max_distance + 1;
+		}
+		for (std::unordered_map<std::size_t, group>::iterator it = groups.begin(); it != groups.end(); ++it) {
+			group& gr = it->second;
+			unsigned missing = 0;
+			for (std::unordered_map<std::size_t, int>::iterator t = gr.targets.begin(); t != gr.targets.end(); ++t)
+				missing += t->second > 0;
+			gr.known[it->first] = 0;
+			int found_at = 0;
+			group_recording recording = { gr, users, missing, found_at };
+			if (missing > 0)
+				search.explore(g, it->first, max_distance, recording);
+			// every vertex up to the level the last target was found on has been seen
+			gr.horizon = missing == 0 ? found_at + 1 : max_distance + 1;
+			traversals++;
+		}
+	}
+
+	// an edge was inserted while scoring the window
+	void edge_added(std::size_t a, std::size_t b) {
+		if (!groups.empty())
+			inserted.push_back(std::make_pair(a, b));
+	}
+
+	// the distance between source and target (max_distance + 1 beyond it) from the window
+	// traversal of source, false when source was not grouped or a new edge may change it
+	template <typename Graph>
+	bool answer(const Graph& g, std::size_t source, std::size_t target, int& distance) {
+		std::unordered_map<std::size_t, group>::const_iterator it = groups.find(source);
+		if (it == groups.end())
+			return false;
+		std::unordered_map<std::size_t, int>::const_iterator t = it->second.targets.find(target);
+		if (t == it->second.targets.end())
+			return false;
+		int d0 = t->second;
+		for (std::size_t indx = 0; indx < inserted.size(); indx++) {
+			std::size_t a = inserted[indx].first, b = inserted[indx].second;
+			if (may_shorten(g, it->second, source, target, a, b, d0)
+					|| may_shorten(g, it->second, source, target, b, a, d0)) {
+				fallbacks++;
+				return false;
+			}
+		}
+		distance = d0;
+		answers++;
+		return true;
+	}
+
+	unsigned long grouped_traversals() const { return traversals; }
+	unsigned long grouped_answers() const { return answers; }
+	unsigned long grouped_fallbacks() const { return fallbacks; }
+};
+
+#endif /* SOURCE_GROUPS_H_ */
@@ -0,0 +1,239 @@
+/*
+ * stream_merge.h
+ *
+ * Ingest stage for several payment feeds. Every feed (regular file or FIFO)
+ * is parsed by its own thread into chunks of records, and the feeds are
+ * k-way merged by timestamp with a loser tree so that the scorer sees one
+ * stream in global time order. A feed of binary records (see
+ * binary_payments.h) is mapped and read in place instead. Given a quarantine
+ * log, the CSV feeds are read strictly and their malformed lines logged (and
+ * handed over as malformed payments, see quarantine.h).
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef STREAM_MERGE_H_
+#define STREAM_MERGE_H_
+
+#include <climits>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "binary_payments.h"
+#include "bounded_queue.h"
+#include "payment.h"
+#include "quarantine.h"
+
+/* A loser tree (tournament tree) over k keyed leaves. The root holds the
+ * overall winner (smallest key) and every internal node remembers the loser
+ * of the match played there, so replacing the winner's key only replays the
+ * matches on the path from its leaf to the root: log2(k) comparisons, against
+ * the 2*log2(k) of a binary heap. Ties are broken by leaf index which keeps
+ * the merge stable.
+ * REF: Knuth, TAOCP Vol. 3, 5.4.1 (replacement selection)
+ */
+template <typename Key>
+class loser_tree {
+private:
+	unsigned k;
+	std::vector<Key> keys;
+	std::vector<unsigned> losers; // losers[0] holds the overall winner
+
+	bool beats(unsigned a, unsigned b) const {
+		return keys[a] < keys[b] || (!(keys[b] < keys[a]) && a < b);
+	}
+
+	// leaves live at positions k..2k-1, internal nodes at 1..k-1
+	unsigned build(unsigned node) {
+		if (node >= k)
+			return node - k;
+		unsigned left = build(2 * node);
+		unsigned right = build(2 * node + 1);
+		if (beats(right, left)) {
+			losers[node] = left;
+			return right;
+		}
+		losers[node] = right;
+		return left;
+	}
+public:
+	explicit loser_tree(const std::vector<Key>& initial) :
+		k(initial.size()), keys(initial), losers(initial.empty() ? 1 : initial.size(), 0) {
+		if (k > 0)
+			losers[0] = build(1);
+	}
+
+	unsigned size() const { return k; }
+	unsigned top() const { return losers[0]; }
+	const Key& top_key() const { return keys[losers[0]]; }
+
+	// sets a new key for the current winner and replays its path to the root
+	void replace_top(const Key& key) {
+		unsigned winner = losers[0];
+		keys[winner] = key;
+		for (unsigned node = (winner + k) / 2; node > 0; node /= 2) {
+			if (beats(losers[node], winner))
+				std::swap(losers[node], winner);
+		}
+		losers[0] = winner;
+	}
+};
+
+// stream_reader parses one payment feed on a dedicated thread. Records are
+// handed to the consumer in chunks through a bounded queue, so the parser can
+// only run a few chunks ahead of the merge. A binary feed needs no parser, its
+// records are taken from the mapping as the consumer asks for them.
+class stream_reader : public payment_source {
+private:
+	std::string path;
+	std::vector<char> buffer;
+	std::ifstream file;
+	std::size_t chunk_size;
+	bounded_queue<data_t> chunks;
+	data_t chunk; // chunk currently being consumed
+	std::size_t chunk_pos;
+	bool reached_eof;
+	std::thread parser;
+	std::unique_ptr<binary_payment_file> binary; // null for a CSV feed
+	bool mapped;
+	std::size_t binary_pos;
+	quarantine_log* quarantine; // null when the feed is read leniently
+
+	void parse() {
+		// removing the first line of the payment CSV file (PayMo header)
+		std::string line;
+		std::getline(file, line);
+
+		data_t batch;
+		batch.reserve(chunk_size);
+		payment_t record;
+		long epoch = invalid_epoch; // of the last record read
+		for (unsigned long number = 2; std::getline(file, line); number++) {
+			if (!read_record(line, record, quarantine, path, number))
+				malformed_record(line, epoch, record);
+			epoch = record.epoch;
+			batch.push_back(record);
+			// a chunk is handed over when full, or as soon as the next read would have
+			// to wait for the writer of a FIFO (keeps latency low for slow feeds)
+			if (batch.size() >= chunk_size || file.rdbuf()->in_avail() <= 0) {
+				if (!chunks.push(std::move(batch)))
+					return;
+				batch = data_t();
+				batch.reserve(chunk_size);
+			}
+		}
+		if (!batch.empty())
+			chunks.push(std::move(batch));
+		reached_eof = file.eof();
+		chunks.close();
+	}
+public:
+	stream_reader(const std::string& path, quarantine_log* quarantine = 0, std::size_t chunk_size = 4096,
+			std::size_t queued_chunks = 8) :
+		path(path), buffer(1 << 20), chunk_size(chunk_size), chunks(queued_chunks),
+		chunk_pos(0), reached_eof(false), mapped(false), binary_pos(0), quarantine(quarantine) {
+		if (binary_payment_file::detect(path)) {
+			binary.reset(new binary_payment_file());
+			mapped = reached_eof = binary->open(path);
+			chunks.close();
+			return;
+		}
+		file.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+		file.open(path.c_str());
+		if (file.is_open())
+			parser = std::thread(&stream_reader::parse, this);
+		else
+			chunks.close();
+	}
+
+	~stream_reader() {
+		chunks.close();
+		if (parser.joinable())
+			parser.join();
+	}
+
+	const std::string& name() const { return path; }
+	bool is_open() const { return binary ? mapped : file.is_open(); }
+
+	// valid once the reader is exhausted: true if the whole feed was read
+	bool good() const { return reached_eof; }
+
+	bool next(payment_t& payment) {
+		if (binary) {
+			if (binary_pos >= binary->size())
+				return false;
+			binary->get(binary_pos++, payment);
+			return true;
+		}
+		while (chunk_pos >= chunk.size()) {
+			if (!chunks.pop(chunk))
+				return false;
+			chunk_pos = 0;
+		}
+		payment = std::move(chunk[chunk_pos++]);
+		return true;
+	}
+};
+
+// merge key of a feed without records left
+const long stream_exhausted = LONG_MAX;
+
+// stream_merger k-way merges several time ordered feeds by timestamp. Each feed
+// is read by its own stream_reader thread, the merge itself runs on the thread
+// pulling from the merger.
+class stream_merger : public payment_source {
+private:
+	std::vector<std::unique_ptr<stream_reader> > readers;
+	std::vector<payment_t> heads; // next record of every feed
+	std::unique_ptr<loser_tree<long> > tree;
+
+	long fetch(unsigned source) {
+		payment_t& head = heads[source];
+		return readers[source]->next(head) ? head.epoch : stream_exhausted;
+	}
+public:
+	explicit stream_merger(const std::vector<std::string>& paths, quarantine_log* quarantine = 0) : heads(paths.size()) {
+		for (unsigned indx = 0; indx < paths.size(); indx++)
+			readers.push_back(std::unique_ptr<stream_reader>(new stream_reader(paths[indx], quarantine)));
+	}
+
+	unsigned size() const { return readers.size(); }
+	const stream_reader& reader(unsigned source) const { return *readers[source]; }
+
+	bool is_open() const {
+		for (unsigned indx = 0; indx < readers.size(); indx++)
+			if (!readers[indx]->is_open())
+				return false;
+		return true;
+	}
+
+	// valid once the merger is exhausted: true if every feed was read completely
+	bool good() const {
+		for (unsigned indx = 0; indx < readers.size(); indx++)
+			if (!readers[indx]->good())
+				return false;
+		return true;
+	}
+
+	bool next(payment_t& payment) {
+		if (!tree) {
+			// the tree is primed lazily since it has to wait for the first record of every feed
+			std::vector<long> keys(readers.size());
+			for (unsigned indx = 0; indx < readers.size(); indx++)
+				keys[indx] = fetch(indx);
+			tree.reset(new loser_tree<long>(keys));
+		}
+		if (tree->size() == 0 || tree->top_key() == stream_exhausted)
+			return false;
+		unsigned source = tree->top();
+		payment = std::move(heads[source]);
+		tree->replace_top(fetch(source));
+		return true;
+	}
+};
+
+#endif /* STREAM_MERGE_H_ */
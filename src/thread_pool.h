@@ -0,0 +1,225 @@
+/*
+ * thread_pool.h
+ *
+ * Work stealing thread pool for the data parallel parts of the scorer (index
+ * builds, giant search frontiers, benchmark batches). The threads are started
+ * once and sleep between jobs, so handing a loop to the pool costs a wake up
+ * instead of a thread creation.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+/* A range of loop indices still to be processed. */
+struct range_task {
+	std::size_t first;
+	std::size_t last;
+};
+
+/* Chase-Lev deque: the owner pushes and pops at the bottom, thieves take from
+ * the top, and only the last element needs a compare and swap. Tasks are
+ * ranges split in halves, so a deque never holds more than one task per
+ * halving (at most 64), and a fixed ring is enough.
+ * REF: Chase, Lev, "Dynamic Circular Work-Stealing Deque" (SPAA 2005)
+ * REF: Le, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013)
+ */
+class work_deque {
+private:
+	static const long capacity = 64;
+	std::atomic<long> top;
+	std::atomic<long> bottom;
+	std::atomic<std::size_t> firsts[capacity];
+	std::atomic<std::size_t> lasts[capacity];
+public:
+	work_deque() : top(0), bottom(0) {}
+
+	void push(const range_task& task) {
+		long b = bottom.load(std::memory_order_relaxed);
+		firsts[b % capacity].store(task.first, std::memory_order_relaxed);
+		lasts[b % capacity].store(task.last, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	// owner side, false when empty
+	bool pop(range_task& task) {
+		long b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long t = top.load(std::memory_order_relaxed);
+		if (t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+		task.first = firsts[b % capacity].load(std::memory_order_relaxed);
+		task.last = lasts[b % capacity].load(std::memory_order_relaxed);
+		if (t == b) {
+			// the last task, a thief may be taking it as well
+			bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+		return true;
+	}
+
+	// thief side, false when empty or when another thread won the task
+	bool steal(range_task& task) {
+		long t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return false;
+		task.first = firsts[t % capacity].load(std::memory_order_relaxed);
+		task.last = lasts[t % capacity].load(std::memory_order_relaxed);
+		return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+};
+
+/* parallel_for puts the whole range on the deque of the calling thread (worker
+ * 0). A worker keeps splitting the range it holds, pushing the upper half and
+ * continuing with the lower one, until it is down to grain indices; idle
+ * workers steal the oldest (largest) halves from the others. The call returns
+ * once every index has been processed. Only one loop runs at a time.
+ */
+class thread_pool {
+private:
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<work_deque> > deques; // one per worker, 0 is the calling thread
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned long generation; // bumped for every job
+	unsigned busy; // workers still running the current job
+	bool stopping;
+
+	std::function<void(std::size_t, std::size_t, unsigned)> body;
+	std::atomic<std::size_t> pending; // indices of the current job not processed yet
+	std::size_t grain;
+
+	static void pin(std::thread::native_handle_type thread, unsigned worker) {
+		unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(worker % cores, &cpus);
+		pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+	}
+
+	void run(range_task task, unsigned worker) {
+		while (task.last - task.first > grain) {
+			std::size_t middle = task.first + (task.last - task.first) / 2;
+			range_task upper = { middle, task.last };
+			deques[worker]->push(upper);
+			task.last = middle;
+		}
+		body(task.first, task.last, worker);
+		pending.fetch_sub(task.last - task.first, std::memory_order_acq_rel);
+	}
+
+	// works on the current job until all of its indices are processed
+	void participate(unsigned worker) {
+		unsigned victim = worker;
+		range_task task;
+		while (pending.load(std::memory_order_acquire) > 0) {
+			if (deques[worker]->pop(task)) {
+				run(task, worker);
+				continue;
+			}
+			victim = (victim + 1) % deques.size();
+			if (victim != worker && deques[victim]->steal(task))
+				run(task, worker);
+			else if (victim == worker)
+				std::this_thread::yield(); // went round every deque without finding work
+		}
+	}
+
+	void work(unsigned worker) {
+		unsigned long seen = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				wake.wait(guard, [&] { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+			}
+			participate(worker);
+			std::lock_guard<std::mutex> guard(lock);
+			if (--busy == 0)
+				done.notify_one();
+		}
+	}
+
+	thread_pool(const thread_pool&);
+	thread_pool& operator=(const thread_pool&);
+public:
+	// threads counts the calling thread, a pool of 1 runs everything inline; pinned
+	// workers are bound to one core each (worker i to core i)
+	explicit thread_pool(unsigned threads, bool pinned = false) : generation(0), busy(0), stopping(false),
+		pending(0), grain(1) {
+		threads = std::max(1u, threads);
+		for (unsigned worker = 0; worker < threads; worker++)
+			deques.push_back(std::unique_ptr<work_deque>(new work_deque()));
+		for (unsigned worker = 1; worker < threads; worker++) {
+			workers.push_back(std::thread(&thread_pool::work, this, worker));
+			if (pinned)
+				pin(workers.back().native_handle(), worker);
+		}
+		if (pinned)
+			pin(pthread_self(), 0);
+	}
+
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::size_t indx = 0; indx < workers.size(); indx++)
+			workers[indx].join();
+	}
+
+	unsigned size() const { return workers.size() + 1; }
+
+	// calls loop(first, last, worker) over chunks of at most chunk indices covering [first, last)
+	template <typename Loop>
+	void parallel_for(std::size_t first, std::size_t last, std::size_t chunk, Loop loop) {
+		if (first >= last)
+			return;
+		chunk = std::max<std::size_t>(1, chunk);
+		if (workers.empty() || last - first <= chunk) {
+			for (std::size_t from = first; from < last; from += chunk)
+				loop(from, std::min(last, from + chunk), 0);
+			return;
+		}
+		range_task whole = { first, last };
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			body = loop;
+			grain = chunk;
+			pending.store(last - first);
+			deques[0]->push(whole);
+			busy = workers.size();
+			generation++;
+		}
+		wake.notify_all();
+		participate(0);
+		std::unique_lock<std::mutex> guard(lock);
+		done.wait(guard, [&] { return busy == 0; });
+	}
+};
+
+#endif /* THREAD_POOL_H_ */
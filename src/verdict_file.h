@@ -0,0 +1,116 @@
+/*
+ * verdict_file.h
+ *
+ * Compact verdict output: a byte of flags per stream payment (and optionally
+ * a byte of friendship degree) instead of three lines of text, written through
+ * a large buffer. The n-th record is the verdict of the n-th payment scored
+ * (the stream sequence number, from 0), which is also the n-th line of the
+ * text outputs.
+ *
+ * Layout:
+ *
+ *   header (16 bytes)
+ *     0  char[8]  magic "PAYMOVRD"
+ *     8  uint32   format version (1), little endian
+ *    12  uint32   record size in bytes, little endian: 1, or 2 with the degree
+ *   records, one per payment until the end of the file
+ *     0  uint8    flags (verdict_* below)
+ *     1  uint8    friendship degree: 1 to 4, 5 beyond the 4th degree, 0 when not scored
+ *                   or for a payment to oneself, told apart by the verdict_self flag
+ *
+ * The file holds no record count, so it can be written to a FIFO as well: the
+ * number of records follows from the size of the file.
+ *
+ *  Created on: 18.10.2026
+ *      Author: ovalerio
+ */
+#ifndef VERDICT_FILE_H_
+#define VERDICT_FILE_H_
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+const char verdict_magic[8] = { 'P', 'A', 'Y', 'M', 'O', 'V', 'R', 'D' };
+const uint32_t verdict_version = 1;
+
+const uint8_t verdict_unverified1 = 1; // feature 1 alerts: the users are not direct friends
+const uint8_t verdict_unverified2 = 2; // feature 2 alerts: beyond the 2nd degree
+const uint8_t verdict_unverified3 = 4; // feature 3 alerts: beyond the 4th degree
+const uint8_t verdict_rejected = 8; // not scored under overload, the feature bits are clear
+const uint8_t verdict_undetermined = 16; // the search ran out of budget, the degree is the policy's pick
+const uint8_t verdict_duplicate = 32; // a repeated record of an earlier payment
+const uint8_t verdict_malformed = 64; // a quarantined line (see --quarantine), not scored
+const uint8_t verdict_self = 128; // a payment to oneself, scored at degree 0 (no alert)
+
+const std::size_t verdict_buffer = 1 << 20; // bytes gathered before a write
+
+class verdict_writer {
+private:
+	std::FILE* file;
+	bool degrees;
+	std::vector<uint8_t> buffer;
+	std::size_t used;
+	unsigned long long count;
+	bool failed;
+
+	verdict_writer(const verdict_writer&);
+	verdict_writer& operator=(const verdict_writer&);
+
+	void flush() {
+		failed = failed || (used > 0 && std::fwrite(&buffer[0], used, 1, file) != 1);
+		used = 0;
+	}
+
+	static void put_le32(uint8_t* at, uint32_t value) {
+		for (unsigned indx = 0; indx < 4; indx++)
+			at[indx] = value >> (8 * indx);
+	}
+public:
+	explicit verdict_writer(bool with_degrees) : file(0), degrees(with_degrees), buffer(verdict_buffer),
+		used(0), count(0), failed(false) {}
+
+	~verdict_writer() {
+		if (file)
+			close();
+	}
+
+	// creates the file and writes the header, false if it cannot be written
+	bool open(const std::string& path) {
+		file = std::fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+		std::setvbuf(file, 0, _IONBF, 0); // the records are buffered here already
+		uint8_t header[16];
+		std::memcpy(header, verdict_magic, sizeof(verdict_magic));
+		put_le32(header + 8, verdict_version);
+		put_le32(header + 12, degrees ? 2 : 1);
+		std::memcpy(&buffer[0], header, sizeof(header));
+		used = sizeof(header);
+		return true;
+	}
+
+	void write(uint8_t flags, uint8_t degree) {
+		if (used + 2 > buffer.size())
+			flush();
+		buffer[used++] = flags;
+		if (degrees)
+			buffer[used++] = degree;
+		count++;
+	}
+
+	// writes out what is buffered and closes the file, false if any write failed
+	bool close() {
+		flush();
+		failed = std::fclose(file) != 0 || failed;
+		file = 0;
+		return !failed;
+	}
+
+	unsigned long long records() const { return count; }
+};
+
+#endif /* VERDICT_FILE_H_ */